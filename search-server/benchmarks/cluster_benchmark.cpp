@@ -0,0 +1,115 @@
+#include "../search_cluster.h"
+#include "../search_server.h"
+#include "../log_duration.h"
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+
+using namespace std;
+
+vector<string> GenerateDocuments(int document_count) {
+    mt19937 generator;
+    vector<string> documents;
+    documents.reserve(document_count);
+    for (int i = 0; i < document_count; ++i) {
+        string document;
+        const int word_count = uniform_int_distribution(3, 30)(generator);
+        for (int j = 0; j < word_count; ++j) {
+            // Минимум двух равномерных величин: частые слова встречаются во многих документах
+            const int word = min(uniform_int_distribution(0, 5'000)(generator), uniform_int_distribution(0, 5'000)(generator));
+            document += "word"s + to_string(word) + " "s;
+        }
+        documents.push_back(move(document));
+    }
+    return documents;
+}
+
+vector<string> GenerateQueries(int query_count) {
+    mt19937 generator(1);
+    vector<string> queries;
+    for (int i = 0; i < query_count; ++i) {
+        string query;
+        const int word_count = uniform_int_distribution(1, 4)(generator);
+        for (int j = 0; j < word_count; ++j) {
+            query += "word"s + to_string(uniform_int_distribution(0, 500)(generator)) + " "s;
+        }
+        if (i % 4 == 0) {
+            query += "-word"s + to_string(uniform_int_distribution(0, 100)(generator));
+        }
+        queries.push_back(move(query));
+    }
+    return queries;
+}
+
+// Порядок документов с равными релевантностью и рейтингом не определен, поэтому сравниваются только они
+bool IsSameResult(const vector<Document>& lhs, const vector<Document>& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (abs(lhs[i].relevance - rhs[i].relevance) > 1e-9 || lhs[i].rating != rhs[i].rating) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename ScoringModel>
+int CountMismatches(const SearchServer& search_server, SearchCluster& cluster, const vector<string>& queries) {
+    int mismatch_count = 0;
+    for (const string& query : queries) {
+        if (!IsSameResult(search_server.FindTopDocuments<ScoringModel>(query), cluster.FindTopDocuments<ScoringModel>(query))) {
+            ++mismatch_count;
+        }
+    }
+    return mismatch_count;
+}
+
+template <typename Server>
+void RunQueries(const string& title, Server& server, const vector<string>& queries) {
+    size_t result_count = 0;
+    {
+        LOG_DURATION(title);
+        for (const string& query : queries) {
+            result_count += server.FindTopDocuments(query).size();
+        }
+    }
+    cout << "  "s << result_count << " documents found"s << endl;
+}
+
+int main() {
+    const auto documents = GenerateDocuments(50'000);
+    const auto queries = GenerateQueries(500);
+
+    SearchCluster cluster("and with"s, { 4 });
+    SearchServer search_server("and with"s);
+    {
+        LOG_DURATION("cluster load"s);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            cluster.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { static_cast<int>(i % 7) - 3 });
+        }
+    }
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { static_cast<int>(i % 7) - 3 });
+    }
+    for (int document_id = 0; document_id < 50'000; document_id += 9) {
+        cluster.RemoveDocument(document_id);
+        search_server.RemoveDocument(document_id);
+    }
+
+    RunQueries("single process"s, search_server, queries);
+    RunQueries("cluster, 4 workers"s, cluster, queries);
+
+    int mismatch_count = CountMismatches<TfIdfScoring>(search_server, cluster, queries)
+        + CountMismatches<Bm25Scoring>(search_server, cluster, queries);
+
+    // Узел убит между запросами: кластер перезапускает его при следующем обращении
+    kill(cluster.GetWorkerPid(1), SIGKILL);
+    mismatch_count += CountMismatches<Bm25Scoring>(search_server, cluster, queries);
+    cout << "restarts: "s << cluster.GetRestartCount() << ", mismatches: "s << mismatch_count << endl;
+    return mismatch_count == 0 && cluster.GetRestartCount() == 1 ? 0 : 1;
+}
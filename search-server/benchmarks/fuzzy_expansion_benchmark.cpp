@@ -0,0 +1,69 @@
+#include "../search_server.h"
+#include "../log_duration.h"
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+// Слово словаря с одной случайной опечаткой
+string MakeTypo(mt19937& generator, string word) {
+    const size_t position = uniform_int_distribution<size_t>(0, word.size() - 1)(generator);
+    word[position] = uniform_int_distribution('a', 'z')(generator);
+    return word;
+}
+
+void Benchmark(mt19937& generator, int dictionary_size, int max_edits, int query_count) {
+    const auto dictionary = GenerateDictionary(generator, dictionary_size, 10);
+    SearchServer search_server(""s);
+    for (size_t i = 0; i < dictionary.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), dictionary[i], DocumentStatus::ACTUAL, {1});
+    }
+    vector<string> queries;
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(MakeTypo(generator, dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)]));
+    }
+
+    size_t expansion_count = 0;
+    const auto start = steady_clock::now();
+    {
+        LOG_DURATION("dictionary "s + to_string(dictionary.size()) + ", max_edits "s + to_string(max_edits));
+        for (const string& query : queries) {
+            expansion_count += search_server.ExpandFuzzyWord(query, max_edits).size();
+        }
+    }
+    const auto elapsed = duration_cast<microseconds>(steady_clock::now() - start).count();
+    cout << "  "s << elapsed * 1.0 / query_count << " us per word, "s
+         << expansion_count * 1.0 / query_count << " expansions per word"s << endl;
+}
+
+int main() {
+    mt19937 generator;
+    for (const int max_edits : {1, 2}) {
+        for (const int dictionary_size : {1'000, 10'000, 100'000, 1'000'000}) {
+            Benchmark(generator, dictionary_size, max_edits, 1'000);
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#include "../durable_search_server.h"
+#include "../log_duration.h"
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+vector<string> GenerateDocuments(int document_count) {
+    mt19937 generator;
+    vector<string> documents;
+    documents.reserve(document_count);
+    for (int i = 0; i < document_count; ++i) {
+        string document;
+        for (int j = 0; j < 10; ++j) {
+            document += "word"s + to_string(uniform_int_distribution(0, 5'000)(generator)) + " "s;
+        }
+        documents.push_back(move(document));
+    }
+    return documents;
+}
+
+// Каждый поток добавляет свою часть документов; без sync_mode сервер работает без журнала
+void Benchmark(const vector<string>& documents, int writer_count, const WalSyncMode* sync_mode) {
+    const string path = (filesystem::temp_directory_path() / "wal_benchmark.log").string();
+    remove(path.c_str());
+
+    SearchServer search_server("and with"s);
+    const string title = (sync_mode == nullptr ? "no log"s
+                          : *sync_mode == WalSyncMode::NONE ? "log without fsync"s
+                          : *sync_mode == WalSyncMode::PER_RECORD ? "fsync per record"s
+                          : "group commit"s)
+        + ", writers "s + to_string(writer_count);
+    uint64_t sync_count = 0;
+    const auto start = steady_clock::now();
+    {
+        LOG_DURATION(title);
+        WriteAheadLog log(path, sync_mode == nullptr ? WalSyncMode::NONE : *sync_mode);
+        DurableSearchServer durable_server(search_server, log);
+        vector<thread> writers;
+        for (int writer = 0; writer < writer_count; ++writer) {
+            writers.emplace_back([&, writer] {
+                for (size_t i = writer; i < documents.size(); i += writer_count) {
+                    if (sync_mode == nullptr) {
+                        static mutex server_mutex;
+                        lock_guard guard(server_mutex);
+                        search_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+                    } else {
+                        durable_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+                    }
+                }
+            });
+        }
+        for (thread& writer : writers) {
+            writer.join();
+        }
+        sync_count = log.GetSyncCount();
+    }
+    const auto elapsed = duration_cast<microseconds>(steady_clock::now() - start).count();
+    cout << "  "s << documents.size() * 1'000'000.0 / elapsed << " documents per second, "s
+         << sync_count << " fsync calls"s << endl;
+    remove(path.c_str());
+}
+
+int main() {
+    const auto documents = GenerateDocuments(5'000);
+    for (const int writer_count : {1, 8}) {
+        Benchmark(documents, writer_count, nullptr);
+        for (const WalSyncMode sync_mode : {WalSyncMode::NONE, WalSyncMode::PER_RECORD, WalSyncMode::GROUP_COMMIT}) {
+            Benchmark(documents, writer_count, &sync_mode);
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <map>
+#include <memory_resource>
 #include <vector>
 #include <mutex>
 
@@ -51,6 +52,16 @@ public:
         }
         return result;
     }
+
+    // Слияние в map на заданном ресурсе, например на арене запроса
+    std::pmr::map<Key, Value> BuildOrdinaryMap(std::pmr::memory_resource* resource) {
+        std::pmr::map<Key, Value> result(resource);
+        for (auto& [mutex, map] : buckets_) {
+            std::lock_guard guard(mutex);
+            result.insert(map.begin(), map.end());
+        }
+        return result;
+    }
     
     
 
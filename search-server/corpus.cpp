@@ -0,0 +1,184 @@
+#include "corpus.h"
+
+#include <algorithm>
+#include <charconv>
+#include <exception>
+#include <execution>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "mapped_file.h"
+
+using namespace std;
+
+static string_view NextField(string_view& line) {
+    const size_t tab = line.find('\t');
+    if (tab == string_view::npos) {
+        throw invalid_argument("Corpus record must have four tab-separated fields"s);
+    }
+    const string_view field = line.substr(0, tab);
+    line.remove_prefix(tab + 1);
+    return field;
+}
+
+static int ParseInt(string_view text) {
+    int value = 0;
+    const auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    if (error != errc() || end != text.data() + text.size()) {
+        throw invalid_argument("Invalid number in corpus record: "s + string(text));
+    }
+    return value;
+}
+
+static DocumentStatus ParseStatus(string_view text) {
+    if (text == "ACTUAL"sv) {
+        return DocumentStatus::ACTUAL;
+    }
+    if (text == "IRRELEVANT"sv) {
+        return DocumentStatus::IRRELEVANT;
+    }
+    if (text == "BANNED"sv) {
+        return DocumentStatus::BANNED;
+    }
+    if (text == "REMOVED"sv) {
+        return DocumentStatus::REMOVED;
+    }
+    throw invalid_argument("Invalid document status: "s + string(text));
+}
+
+//Разбор строки корпуса; текст документа не копируется
+CorpusRecord ParseCorpusRecord(string_view line) {
+    CorpusRecord record;
+    record.document_id = ParseInt(NextField(line));
+    record.status = ParseStatus(NextField(line));
+    string_view ratings = NextField(line);
+    while (!ratings.empty()) {
+        const size_t comma = ratings.find(',');
+        record.ratings.push_back(ParseInt(ratings.substr(0, comma)));
+        ratings.remove_prefix(comma == string_view::npos ? ratings.size() : comma + 1);
+    }
+    if (record.ratings.empty()) {
+        throw invalid_argument("Corpus record has no ratings"s);
+    }
+    record.text = line;
+    return record;
+}
+
+size_t LoadCorpus(istream& input, SearchServer& search_server) {
+    size_t document_count = 0;
+    string line;
+    while (getline(input, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            continue;
+        }
+        const CorpusRecord record = ParseCorpusRecord(line);
+        search_server.AddDocument(record.document_id, record.text, record.status, record.ratings);
+        ++document_count;
+    }
+    return document_count;
+}
+
+// Часть файла из целых строк и ее разобранные записи; при ошибке - записи до ошибочной строки
+struct CorpusRange {
+    string_view text;
+    vector<CorpusRecord> records;
+    exception_ptr error;
+};
+
+// Диапазоны мельче не окупают запуск задачи
+const size_t MIN_CORPUS_RANGE_SIZE = 1 << 20;
+
+//Деление текста на диапазоны примерно равной длины по границам строк
+static vector<CorpusRange> SplitIntoRanges(string_view text) {
+    const size_t max_range_count = max<size_t>(thread::hardware_concurrency(), 1) * 4;
+    const size_t range_count = clamp<size_t>(text.size() / MIN_CORPUS_RANGE_SIZE, 1, max_range_count);
+    const size_t range_size = text.size() / range_count + 1;
+    vector<CorpusRange> ranges;
+    while (!text.empty()) {
+        const size_t line_end = text.find('\n', min(range_size, text.size()) - 1);
+        const size_t size = line_end == string_view::npos ? text.size() : line_end + 1;
+        ranges.push_back({ text.substr(0, size), {}, nullptr });
+        text.remove_prefix(size);
+    }
+    return ranges;
+}
+
+//Разбор диапазона; исключение из параллельного алгоритма завершило бы программу, поэтому оно сохраняется
+static void ParseRange(CorpusRange& range) {
+    try {
+        string_view text = range.text;
+        while (!text.empty()) {
+            const size_t line_end = text.find('\n');
+            string_view line = text.substr(0, line_end);
+            text.remove_prefix(line_end == string_view::npos ? text.size() : line_end + 1);
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            if (!line.empty()) {
+                range.records.push_back(ParseCorpusRecord(line));
+            }
+        }
+    } catch (...) {
+        range.error = current_exception();
+    }
+}
+
+size_t LoadCorpusFile(const string& path, SearchServer& search_server) {
+    const MappedFile& file = search_server.AdoptMappedFile(MappedFile(path));
+    file.Advise(MappedFileAccess::SEQUENTIAL);
+    file.Advise(MappedFileAccess::WILL_NEED);
+
+    vector<CorpusRange> ranges = SplitIntoRanges(file.GetData());
+    for_each(execution::par, ranges.begin(), ranges.end(), ParseRange);
+
+    // Индекс не допускает параллельной записи, поэтому документы добавляются по одному
+    size_t document_count = 0;
+    for (const CorpusRange& range : ranges) {
+        for (const CorpusRecord& record : range.records) {
+            search_server.AddMappedDocument(record.document_id, record.text, record.status, record.ratings);
+            ++document_count;
+        }
+        if (range.error) {
+            rethrow_exception(range.error);
+        }
+    }
+    // После загрузки текст читается через слова индекса вразброс
+    file.Advise(MappedFileAccess::NORMAL);
+    return document_count;
+}
+
+//Разбор строки журнала запросов; текст запроса может содержать табуляции
+QueryLogRecord ParseQueryLogRecord(string_view line) {
+    QueryLogRecord record;
+    const size_t first_tab = line.find('\t');
+    const size_t second_tab = first_tab == string_view::npos ? string_view::npos : line.find('\t', first_tab + 1);
+    if (second_tab == string_view::npos) {
+        throw invalid_argument("Query log record must have three tab-separated fields"s);
+    }
+    const string_view timestamp = line.substr(0, first_tab);
+    const auto [end, error] = from_chars(timestamp.data(), timestamp.data() + timestamp.size(), record.timestamp_ms);
+    if (error != errc() || end != timestamp.data() + timestamp.size() || record.timestamp_ms < 0.0) {
+        throw invalid_argument("Invalid timestamp in query log record: "s + string(timestamp));
+    }
+    record.status = ParseStatus(line.substr(first_tab + 1, second_tab - first_tab - 1));
+    record.query = line.substr(second_tab + 1);
+    return record;
+}
+
+vector<QueryLogRecord> LoadQueryLog(istream& input) {
+    vector<QueryLogRecord> records;
+    string line;
+    while (getline(input, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            records.push_back(ParseQueryLogRecord(line));
+        }
+    }
+    return records;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "document.h"
+#include "search_server.h"
+
+// Строка корпуса: id<TAB>статус<TAB>оценки через запятую<TAB>текст,
+// статус - ACTUAL, IRRELEVANT, BANNED или REMOVED
+struct CorpusRecord {
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    // Указывает в разобранную строку
+    std::string_view text;
+};
+
+CorpusRecord ParseCorpusRecord(std::string_view line);
+
+// Добавляет документы корпуса в сервер, пустые строки пропускаются; возвращает число документов
+size_t LoadCorpus(std::istream& input, SearchServer& search_server);
+
+// Как LoadCorpus, но файл отображается в память и переходит во владение сервера, а тексты документов
+// не копируются (кроме сервера с приведением регистра). Строки разбираются параллельно по диапазонам
+// файла, документы добавляются в порядке файла. При ошибке разбора документы до ошибочной строки остаются в сервере
+size_t LoadCorpusFile(const std::string& path, SearchServer& search_server);
+
+// Строка журнала запросов: время в миллисекундах от начала записи<TAB>статус<TAB>текст запроса
+struct QueryLogRecord {
+    double timestamp_ms = 0.0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::string query;
+};
+
+QueryLogRecord ParseQueryLogRecord(std::string_view line);
+
+// Записи в порядке файла, пустые строки пропускаются
+std::vector<QueryLogRecord> LoadQueryLog(std::istream& input);
@@ -0,0 +1,67 @@
+#include "durable_search_server.h"
+
+#include <stdexcept>
+
+DurableSearchServer::DurableSearchServer(SearchServer& search_server, WriteAheadLog& log)
+    : search_server_(search_server)
+    , log_(log) {
+}
+
+//В журнал попадают только успешно примененные изменения, поэтому повтор журнала не бросает исключений.
+//Если запись в журнал не удалась, документ удаляется из индекса: индекс и журнал не расходятся.
+//Ошибка сохранения пачки обнаруживается позже, в WaitDurable, когда откатить изменение уже нельзя
+void DurableSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                      const std::vector<int>& ratings) {
+    uint64_t lsn = 0;
+    {
+        std::lock_guard guard(mutex_);
+        CheckNotDiverged();
+        search_server_.AddDocument(document_id, document, status, ratings);
+        try {
+            lsn = log_.AppendAddDocument(document_id, document, status, ratings);
+        } catch (...) {
+            search_server_.RemoveDocument(document_id);
+            throw;
+        }
+    }
+    WaitDurable(lsn);
+}
+
+//Удаление не бросает исключений, поэтому запись в журнал идет первой: при ее ошибке индекс не меняется
+void DurableSearchServer::RemoveDocument(int document_id) {
+    uint64_t lsn = 0;
+    {
+        std::lock_guard guard(mutex_);
+        CheckNotDiverged();
+        lsn = log_.AppendRemoveDocument(document_id);
+        search_server_.RemoveDocument(document_id);
+    }
+    WaitDurable(lsn);
+}
+
+const SearchServer& DurableSearchServer::GetSearchServer() const {
+    return search_server_;
+}
+
+bool DurableSearchServer::IsDiverged() const {
+    std::shared_lock lock(mutex_);
+    return is_diverged_;
+}
+
+//Вызывается под mutex_
+void DurableSearchServer::CheckNotDiverged() const {
+    if (is_diverged_) {
+        throw std::runtime_error("Search server has changes missing from the write-ahead log; rebuild it with ReplayWriteAheadLog");
+    }
+}
+
+//Изменение уже применено к индексу, а его запись потеряна вместе с пачкой
+void DurableSearchServer::WaitDurable(uint64_t lsn) {
+    try {
+        log_.WaitDurable(lsn);
+    } catch (...) {
+        std::lock_guard guard(mutex_);
+        is_diverged_ = true;
+        throw;
+    }
+}
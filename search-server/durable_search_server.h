@@ -0,0 +1,41 @@
+#pragma once
+
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+// Сервер с журналом изменений. Изменение применяется к индексу и попадает в журнал под одной
+// блокировкой, а ожидание fsync идет уже без нее, чтобы параллельные писатели попали в одну пачку.
+// Если пачка не сохранилась, ее изменения уже видны в индексе, но не попадут в журнал: сервер
+// помечается разошедшимся с журналом, и все последующие вызовы бросают std::runtime_error.
+// Восстанавливать такой сервер нужно заново через ReplayWriteAheadLog.
+class DurableSearchServer {
+public:
+    DurableSearchServer(SearchServer& search_server, WriteAheadLog& log);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    template <typename... Args>
+    std::vector<Document> FindTopDocuments(Args&&... args) const {
+        std::shared_lock lock(mutex_);
+        CheckNotDiverged();
+        return search_server_.FindTopDocuments(std::forward<Args>(args)...);
+    }
+
+    const SearchServer& GetSearchServer() const;
+    bool IsDiverged() const;
+
+private:
+    void CheckNotDiverged() const;
+    void WaitDurable(uint64_t lsn);
+
+    SearchServer& search_server_;
+    WriteAheadLog& log_;
+    mutable std::shared_mutex mutex_;
+    bool is_diverged_ = false;
+};
@@ -0,0 +1,154 @@
+#include "index_segment.h"
+
+#include <algorithm>
+#include <map>
+
+IndexSegment::IndexSegment(std::vector<std::string> terms, std::vector<size_t> offsets, std::vector<Posting> postings,
+                           std::vector<DocumentInfo> documents)
+    : terms_(std::move(terms))
+    , offsets_(std::move(offsets))
+    , postings_(std::move(postings))
+    , documents_(std::move(documents))
+    , document_term_offsets_(documents_.size() + 1, 0)
+    , document_terms_(postings_.size())
+    , live_document_freqs_(std::make_unique<std::atomic<size_t>[]>(terms_.size()))
+    , deleted_(std::make_unique<std::atomic<bool>[]>(documents_.size())) {
+    for (size_t i = 0; i < documents_.size(); ++i) {
+        total_length_ += documents_[i].length;
+        deleted_[i] = false;
+    }
+    for (size_t term = 0; term < terms_.size(); ++term) {
+        live_document_freqs_[term] = offsets_[term + 1] - offsets_[term];
+        for (size_t i = offsets_[term]; i < offsets_[term + 1]; ++i) {
+            ++document_term_offsets_[postings_[i].document_index + 1];
+        }
+    }
+    for (size_t i = 0; i < documents_.size(); ++i) {
+        document_term_offsets_[i + 1] += document_term_offsets_[i];
+    }
+    std::vector<size_t> next_positions(document_term_offsets_.begin(), document_term_offsets_.end() - 1);
+    for (size_t term = 0; term < terms_.size(); ++term) {
+        for (size_t i = offsets_[term]; i < offsets_[term + 1]; ++i) {
+            document_terms_[next_positions[postings_[i].document_index]++] = term;
+        }
+    }
+}
+
+//Слияние сегментов: удаленные документы отбрасываются, номера документов пересчитываются
+std::shared_ptr<IndexSegment> IndexSegment::Merge(const std::vector<std::shared_ptr<IndexSegment>>& segments) {
+    std::vector<std::pair<int, std::pair<size_t, size_t>>> live_documents;
+    for (size_t segment = 0; segment < segments.size(); ++segment) {
+        const auto& documents = segments[segment]->documents_;
+        for (size_t i = 0; i < documents.size(); ++i) {
+            if (!segments[segment]->IsDeleted(i)) {
+                live_documents.push_back({documents[i].document_id, {segment, i}});
+            }
+        }
+    }
+    std::sort(live_documents.begin(), live_documents.end());
+
+    std::vector<DocumentInfo> documents;
+    documents.reserve(live_documents.size());
+    std::vector<std::vector<size_t>> new_indexes(segments.size());
+    for (size_t segment = 0; segment < segments.size(); ++segment) {
+        new_indexes[segment].assign(segments[segment]->documents_.size(), documents.max_size());
+    }
+    for (const auto& [document_id, location] : live_documents) {
+        new_indexes[location.first][location.second] = documents.size();
+        documents.push_back(segments[location.first]->documents_[location.second]);
+    }
+
+    std::map<std::string_view, std::vector<Posting>> word_to_postings;
+    for (size_t segment = 0; segment < segments.size(); ++segment) {
+        const IndexSegment& source = *segments[segment];
+        for (size_t term = 0; term < source.terms_.size(); ++term) {
+            std::vector<Posting>* postings = nullptr;
+            for (size_t i = source.offsets_[term]; i < source.offsets_[term + 1]; ++i) {
+                const size_t document_index = new_indexes[segment][source.postings_[i].document_index];
+                if (document_index == documents.max_size()) {
+                    continue;
+                }
+                if (postings == nullptr) {
+                    postings = &word_to_postings[source.terms_[term]];
+                }
+                postings->push_back({document_index, source.postings_[i].term_freq});
+            }
+        }
+    }
+
+    std::vector<std::string> terms;
+    std::vector<size_t> offsets{0};
+    std::vector<Posting> postings;
+    terms.reserve(word_to_postings.size());
+    offsets.reserve(word_to_postings.size() + 1);
+    for (auto& [word, word_postings] : word_to_postings) {
+        std::sort(word_postings.begin(), word_postings.end(), [](const Posting& lhs, const Posting& rhs) {
+            return lhs.document_index < rhs.document_index;
+        });
+        terms.emplace_back(word);
+        postings.insert(postings.end(), word_postings.begin(), word_postings.end());
+        offsets.push_back(postings.size());
+    }
+    return std::make_shared<IndexSegment>(std::move(terms), std::move(offsets), std::move(postings), std::move(documents));
+}
+
+std::pair<const IndexSegment::Posting*, const IndexSegment::Posting*> IndexSegment::GetPostings(std::string_view word) const {
+    const auto it = std::lower_bound(terms_.begin(), terms_.end(), word);
+    if (it == terms_.end() || *it != word) {
+        return {nullptr, nullptr};
+    }
+    const size_t term = static_cast<size_t>(it - terms_.begin());
+    return {postings_.data() + offsets_[term], postings_.data() + offsets_[term + 1]};
+}
+
+size_t IndexSegment::GetLiveDocumentFreq(std::string_view word) const {
+    const auto it = std::lower_bound(terms_.begin(), terms_.end(), word);
+    if (it == terms_.end() || *it != word) {
+        return 0;
+    }
+    return live_document_freqs_[it - terms_.begin()].load(std::memory_order_relaxed);
+}
+
+const std::vector<IndexSegment::DocumentInfo>& IndexSegment::GetDocuments() const {
+    return documents_;
+}
+
+const std::vector<std::string>& IndexSegment::GetTerms() const {
+    return terms_;
+}
+
+bool IndexSegment::IsDeleted(size_t document_index) const {
+    return deleted_[document_index].load(std::memory_order_relaxed);
+}
+
+bool IndexSegment::MarkDeleted(int document_id) {
+    const auto it = std::lower_bound(documents_.begin(), documents_.end(), document_id,
+        [](const DocumentInfo& document, int id) {
+            return document.document_id < id;
+        });
+    if (it == documents_.end() || it->document_id != document_id) {
+        return false;
+    }
+    const size_t document_index = static_cast<size_t>(it - documents_.begin());
+    if (deleted_[document_index].exchange(true)) {
+        return false;
+    }
+    for (size_t i = document_term_offsets_[document_index]; i < document_term_offsets_[document_index + 1]; ++i) {
+        live_document_freqs_[document_terms_[i]].fetch_sub(1, std::memory_order_relaxed);
+    }
+    deleted_count_ += 1;
+    deleted_length_ += it->length;
+    return true;
+}
+
+size_t IndexSegment::GetLiveDocumentCount() const {
+    return documents_.size() - deleted_count_;
+}
+
+size_t IndexSegment::GetLiveDocumentLength() const {
+    return total_length_ - deleted_length_;
+}
+
+size_t IndexSegment::GetPostingCount() const {
+    return postings_.size();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "document.h"
+
+// Неизменяемый сегмент индекса: отсортированный словарь и плоский массив записей (документ, tf).
+// Изменяемы только отметки об удалении, поэтому сегмент читается без блокировок.
+class IndexSegment {
+public:
+    struct Posting {
+        // Номер документа в GetDocuments(), записи одного слова упорядочены по нему
+        size_t document_index;
+        double term_freq;
+    };
+
+    struct DocumentInfo {
+        int document_id;
+        int rating;
+        DocumentStatus status;
+        // Число слов документа без стоп-слов
+        int length;
+    };
+
+    // documents упорядочены по id, offsets[i]..offsets[i + 1] - записи слова terms[i]
+    IndexSegment(std::vector<std::string> terms, std::vector<size_t> offsets, std::vector<Posting> postings,
+                 std::vector<DocumentInfo> documents);
+
+    // Сливает живые документы сегментов в один; документы разных сегментов не пересекаются по id
+    static std::shared_ptr<IndexSegment> Merge(const std::vector<std::shared_ptr<IndexSegment>>& segments);
+
+    std::pair<const Posting*, const Posting*> GetPostings(std::string_view word) const;
+    // Число неудаленных документов со словом; поддерживается при удалении, а не считается по записям
+    size_t GetLiveDocumentFreq(std::string_view word) const;
+    const std::vector<DocumentInfo>& GetDocuments() const;
+    const std::vector<std::string>& GetTerms() const;
+
+    bool IsDeleted(size_t document_index) const;
+    // Возвращает false, если документа нет в сегменте или он уже удален
+    bool MarkDeleted(int document_id);
+
+    size_t GetLiveDocumentCount() const;
+    size_t GetLiveDocumentLength() const;
+    size_t GetPostingCount() const;
+
+private:
+    std::vector<std::string> terms_;
+    std::vector<size_t> offsets_;
+    std::vector<Posting> postings_;
+    std::vector<DocumentInfo> documents_;
+    // Номера слов документа i: document_terms_[document_term_offsets_[i]..document_term_offsets_[i + 1]).
+    // Нужны, чтобы при удалении уменьшить число документов у каждого его слова
+    std::vector<size_t> document_term_offsets_;
+    std::vector<size_t> document_terms_;
+    std::unique_ptr<std::atomic<size_t>[]> live_document_freqs_;
+    size_t total_length_ = 0;
+    std::unique_ptr<std::atomic<bool>[]> deleted_;
+    std::atomic<size_t> deleted_count_{0};
+    std::atomic<size_t> deleted_length_{0};
+};
@@ -0,0 +1,45 @@
+#include "levenshtein_automaton.h"
+
+#include <algorithm>
+
+LevenshteinAutomaton::LevenshteinAutomaton(std::string_view word, int max_edits)
+    : word_(word)
+    , max_edits_(max_edits) {
+}
+
+size_t LevenshteinAutomaton::GetStateSize() const {
+    return word_.size() + 1;
+}
+
+void LevenshteinAutomaton::Start(int* state) const {
+    for (size_t i = 0; i <= word_.size(); ++i) {
+        state[i] = std::min(static_cast<int>(i), max_edits_ + 1);
+    }
+}
+
+//Переход по символу: следующая строка таблицы расстояний
+int LevenshteinAutomaton::Step(const int* state, char c, int* next) const {
+    const int limit = max_edits_ + 1;
+    next[0] = std::min(state[0] + 1, limit);
+    int min_distance = next[0];
+    for (size_t i = 1; i <= word_.size(); ++i) {
+        const int substitution = state[i - 1] + (word_[i - 1] == c ? 0 : 1);
+        const int insertion = state[i] + 1;
+        const int deletion = next[i - 1] + 1;
+        next[i] = std::min({ substitution, insertion, deletion, limit });
+        min_distance = std::min(min_distance, next[i]);
+    }
+    return min_distance;
+}
+
+bool LevenshteinAutomaton::IsMatch(const int* state) const {
+    return state[word_.size()] <= max_edits_;
+}
+
+int LevenshteinAutomaton::GetDistance(const int* state) const {
+    return state[word_.size()];
+}
+
+int LevenshteinAutomaton::GetMaxEdits() const {
+    return max_edits_;
+}
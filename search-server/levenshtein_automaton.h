@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Автомат, принимающий слова на расстоянии Левенштейна не больше max_edits от заданного.
+// Состояние - строка таблицы расстояний для прочитанного префикса длины GetStateSize(),
+// значения ограничены max_edits + 1. Память под состояния выделяет вызывающий код.
+class LevenshteinAutomaton {
+public:
+    LevenshteinAutomaton(std::string_view word, int max_edits);
+
+    size_t GetStateSize() const;
+
+    void Start(int* state) const;
+    // Возвращает наименьшее значение новой строки: если оно больше max_edits, продолжения не допускаются
+    int Step(const int* state, char c, int* next) const;
+
+    bool IsMatch(const int* state) const;
+    int GetDistance(const int* state) const;
+    int GetMaxEdits() const;
+
+private:
+    std::string word_;
+    int max_edits_;
+};
@@ -0,0 +1,97 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <functional>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+//Отображение файла; дескриптор после mmap не нужен
+MappedFile::MappedFile(const string& path) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw system_error(errno, generic_category(), "Cannot open "s + path);
+    }
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0) {
+        const int error = errno;
+        close(fd);
+        throw system_error(error, generic_category(), "Cannot stat "s + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            const int error = errno;
+            close(fd);
+            throw system_error(error, generic_category(), "Cannot map "s + path);
+        }
+        data_ = static_cast<char*>(data);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    Unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(exchange(other.data_, nullptr))
+    , size_(exchange(other.size_, 0)) {
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Unmap();
+        data_ = exchange(other.data_, nullptr);
+        size_ = exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+string_view MappedFile::GetData() const {
+    return { data_, size_ };
+}
+
+//Подсказка носит рекомендательный характер, поэтому ошибка madvise не считается ошибкой чтения
+void MappedFile::Advise(MappedFileAccess access) const {
+    if (data_ == nullptr) {
+        return;
+    }
+    int advice = MADV_NORMAL;
+    switch (access) {
+    case MappedFileAccess::NORMAL:
+        advice = MADV_NORMAL;
+        break;
+    case MappedFileAccess::SEQUENTIAL:
+        advice = MADV_SEQUENTIAL;
+        break;
+    case MappedFileAccess::RANDOM:
+        advice = MADV_RANDOM;
+        break;
+    case MappedFileAccess::WILL_NEED:
+        advice = MADV_WILLNEED;
+        break;
+    }
+    madvise(data_, size_, advice);
+}
+
+//Сравнение указателей из разных объектов через std::less, для которого порядок указателей полный
+bool MappedFile::Contains(string_view text) const {
+    const less<const char*> is_before;
+    return data_ != nullptr && !is_before(text.data(), data_) && !is_before(data_ + size_, text.data() + text.size());
+}
+
+void MappedFile::Unmap() {
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Подсказка ядру о порядке чтения отображения (madvise)
+enum class MappedFileAccess {
+    NORMAL,
+    SEQUENTIAL,
+    RANDOM,
+    // Начать чтение всего файла заранее
+    WILL_NEED,
+};
+
+// Файл, отображенный в память только для чтения. Пустой файл не отображается, GetData возвращает пустую строку
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view GetData() const;
+    void Advise(MappedFileAccess access) const;
+    // Лежит ли text целиком в отображении
+    bool Contains(std::string_view text) const;
+
+private:
+    void Unmap();
+
+    char* data_ = nullptr;
+    size_t size_ = 0;
+};
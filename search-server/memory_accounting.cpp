@@ -0,0 +1,57 @@
+#include "memory_accounting.h"
+
+using namespace std;
+
+CountingMemoryResource::CountingMemoryResource(std::pmr::memory_resource* upstream)
+    : upstream_(upstream) {
+}
+
+size_t CountingMemoryResource::GetAllocatedBytes() const {
+    return allocated_bytes_.load(std::memory_order_relaxed);
+}
+
+size_t CountingMemoryResource::GetPeakAllocatedBytes() const {
+    return peak_allocated_bytes_.load(std::memory_order_relaxed);
+}
+
+size_t CountingMemoryResource::GetAllocationCount() const {
+    return allocation_count_.load(std::memory_order_relaxed);
+}
+
+void* CountingMemoryResource::do_allocate(size_t bytes, size_t alignment) {
+    void* pointer = upstream_->allocate(bytes, alignment);
+    const size_t allocated = allocated_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    allocation_count_.fetch_add(1, std::memory_order_relaxed);
+
+    size_t peak = peak_allocated_bytes_.load(std::memory_order_relaxed);
+    while (allocated > peak && !peak_allocated_bytes_.compare_exchange_weak(peak, allocated, std::memory_order_relaxed)) {
+    }
+    return pointer;
+}
+
+void CountingMemoryResource::do_deallocate(void* pointer, size_t bytes, size_t alignment) {
+    upstream_->deallocate(pointer, bytes, alignment);
+    allocated_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    allocation_count_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool CountingMemoryResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+size_t MemoryUsage::GetTotal() const {
+    return word_to_document_freqs + document_to_word_freqs + document_text
+        + documents + document_ids + document_lengths;
+}
+
+ostream& operator<<(ostream& out, const MemoryUsage& usage) {
+    out << "{ "s
+        << "word_to_document_freqs = "s << usage.word_to_document_freqs << ", "s
+        << "document_to_word_freqs = "s << usage.document_to_word_freqs << ", "s
+        << "document_text = "s << usage.document_text << ", "s
+        << "documents = "s << usage.documents << ", "s
+        << "document_ids = "s << usage.document_ids << ", "s
+        << "document_lengths = "s << usage.document_lengths << ", "s
+        << "total = "s << usage.GetTotal() << " }"s;
+    return out;
+}
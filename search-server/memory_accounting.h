@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <memory_resource>
+
+// Ресурс памяти, который ведет точный учет байт, выданных контейнерам индекса
+class CountingMemoryResource : public std::pmr::memory_resource {
+public:
+    explicit CountingMemoryResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+    size_t GetAllocatedBytes() const;
+    size_t GetPeakAllocatedBytes() const;
+    size_t GetAllocationCount() const;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::pmr::memory_resource* upstream_;
+    std::atomic<size_t> allocated_bytes_{0};
+    std::atomic<size_t> peak_allocated_bytes_{0};
+    std::atomic<size_t> allocation_count_{0};
+};
+
+struct MemoryUsage {
+    size_t word_to_document_freqs = 0;
+    size_t document_to_word_freqs = 0;
+    size_t document_text = 0;
+    size_t documents = 0;
+    size_t document_ids = 0;
+    size_t document_lengths = 0;
+
+    size_t GetTotal() const;
+};
+
+std::ostream& operator<<(std::ostream& out, const MemoryUsage& usage);
+
+enum class MemoryBudgetPolicy {
+    FAIL,
+    COMPACT,
+};
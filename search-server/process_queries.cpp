@@ -5,10 +5,15 @@ std::vector<std::vector<Document>> ProcessQueries(
 	const std::vector<std::string>& queries) {
 	std::vector<std::vector<Document>> documents_lists(queries.size());
 
+	// Запросы уже распределены по потокам, поэтому перегрузка с предикатом: она не выбирает стратегию PARALLEL
+	// и не запускает вложенный параллелизм на пуле сервера
 	std::transform(std::execution::par,
 				   queries.begin(), queries.end(),
 				   documents_lists.begin(), [&search_server](const std::string& query) { 
-											 return search_server.FindTopDocuments(query); 
+											 return search_server.FindTopDocuments(query,
+												 [](int document_id, DocumentStatus status, int rating) {
+													 return status == DocumentStatus::ACTUAL;
+												 });
 		});
 
 	return documents_lists;
@@ -23,5 +28,32 @@ std::vector<Document> ProcessQueriesJoined(
 		documents.insert(documents.end(), document.begin(), document.end());
 	}
 
+	return documents;
+}
+
+std::vector<std::vector<Document>> ProcessQueries(
+	const SearchServer& search_server,
+	const std::vector<std::string>& queries,
+	const PoolExecutionPolicy& policy) {
+	std::vector<std::vector<Document>> documents_lists(queries.size());
+
+	search_server.GetThreadPool().ParallelFor(queries.size(),
+		[&search_server, &queries, &documents_lists, &policy](size_t index) {
+			documents_lists[index] = search_server.FindTopDocuments(policy, queries[index]);
+		});
+
+	return documents_lists;
+}
+
+std::vector<Document> ProcessQueriesJoined(
+	const SearchServer& search_server,
+	const std::vector<std::string>& queries,
+	const PoolExecutionPolicy& policy) {
+	std::vector<Document> documents;
+
+	for (const auto& document : ProcessQueries(search_server, queries, policy)) {
+		documents.insert(documents.end(), document.begin(), document.end());
+	}
+
 	return documents;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "document.h"
 #include "search_server.h"
+#include "thread_pool.h"
 #include <vector>
 #include <execution>
 
@@ -12,3 +13,14 @@ std::vector<std::vector<Document>> ProcessQueries(
 std::vector<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
+
+// Запросы распределяются по пулу потоков сервера; параллелизм внутри запросов выполняется на месте
+std::vector<std::vector<Document>> ProcessQueries(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries,
+    const PoolExecutionPolicy& policy);
+
+std::vector<Document> ProcessQueriesJoined(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries,
+    const PoolExecutionPolicy& policy);
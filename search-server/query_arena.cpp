@@ -0,0 +1,50 @@
+#include "query_arena.h"
+
+#include <algorithm>
+
+QueryArena::Scope::Scope() {
+    ++ForCurrentThread().depth_;
+}
+
+QueryArena::Scope::~Scope() {
+    QueryArena& arena = ForCurrentThread();
+    if (--arena.depth_ == 0) {
+        arena.Reset();
+    }
+}
+
+std::pmr::memory_resource* QueryArena::GetResource() {
+    QueryArena& arena = ForCurrentThread();
+    if (arena.depth_ == 0) {
+        return std::pmr::get_default_resource();
+    }
+    return &*arena.resource_;
+}
+
+size_t QueryArena::GetCapacity() {
+    return ForCurrentThread().buffer_size_;
+}
+
+QueryArena::QueryArena()
+    : buffer_(std::make_unique<std::byte[]>(buffer_size_))
+    , overflow_memory_(std::pmr::new_delete_resource()) {
+    resource_.emplace(buffer_.get(), buffer_size_, &overflow_memory_);
+}
+
+QueryArena& QueryArena::ForCurrentThread() {
+    thread_local QueryArena arena;
+    return arena;
+}
+
+//Сброс арены; при переполнении буфер заменяется большим, чтобы следующий такой же запрос в нем уместился
+void QueryArena::Reset() {
+    const size_t overflow_size = overflow_memory_.GetAllocatedBytes();
+    resource_->release();
+    if (overflow_size == 0 || buffer_size_ == QUERY_ARENA_MAX_SIZE) {
+        return;
+    }
+    buffer_size_ = std::min(QUERY_ARENA_MAX_SIZE, buffer_size_ + overflow_size);
+    resource_.reset();
+    buffer_ = std::make_unique<std::byte[]>(buffer_size_);
+    resource_.emplace(buffer_.get(), buffer_size_, &overflow_memory_);
+}
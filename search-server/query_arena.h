@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+#include "memory_accounting.h"
+
+// Монотонная арена для временных структур запроса, своя у каждого потока. Память не освобождается
+// по отдельности, а сбрасывается целиком после запроса. Если запрос не уместился в буфер, буфер
+// увеличивается до использованного объема (не больше QUERY_ARENA_MAX_SIZE), поэтому повторяющиеся
+// запросы не обращаются к общей куче.
+class QueryArena {
+public:
+    static constexpr size_t QUERY_ARENA_INITIAL_SIZE = 64 * 1024;
+    static constexpr size_t QUERY_ARENA_MAX_SIZE = 16 * 1024 * 1024;
+
+    // Запрос на арене текущего потока. Вложенные запросы того же потока (например, из предиката)
+    // используют ту же арену, сброс происходит при выходе из внешнего
+    class Scope {
+    public:
+        Scope();
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // Арена текущего потока внутри Scope, иначе ресурс по умолчанию. Потоки пула, выполняющие часть
+    // чужого запроса, получают ресурс по умолчанию, поэтому арена не используется из двух потоков
+    static std::pmr::memory_resource* GetResource();
+
+    // Размер буфера арены текущего потока
+    static size_t GetCapacity();
+
+private:
+    QueryArena();
+
+    static QueryArena& ForCurrentThread();
+    void Reset();
+
+    size_t buffer_size_ = QUERY_ARENA_INITIAL_SIZE;
+    std::unique_ptr<std::byte[]> buffer_;
+    // Память сверх буфера; ее объем перед сбросом - на сколько не хватило буфера
+    CountingMemoryResource overflow_memory_;
+    std::optional<std::pmr::monotonic_buffer_resource> resource_;
+    int depth_ = 0;
+};
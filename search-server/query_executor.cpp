@@ -0,0 +1,102 @@
+#include "query_executor.h"
+
+#include <algorithm>
+
+QueryExecutor::QueryExecutor(QueryExecutorOptions options)
+    : options_(options) {
+}
+
+QueryExecutor::~QueryExecutor() {
+    {
+        std::lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    task_available_.notify_all();
+    slot_available_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+//Постановка задачи в очередь с учетом ограничения на число ожидающих задач
+bool QueryExecutor::TrySubmit(std::function<void()> task) {
+    {
+        std::unique_lock lock(mutex_);
+        if (workers_.empty()) {
+            StartWorkers();
+        }
+        const auto is_saturated = [this] {
+            return tasks_.size() + running_tasks_ >= options_.max_pending_tasks;
+        };
+        if (is_saturated()) {
+            if (options_.overload_policy == OverloadPolicy::REJECT) {
+                ++rejected_tasks_;
+                return false;
+            }
+            slot_available_.wait(lock, [this, &is_saturated] {
+                return stopping_ || !is_saturated();
+            });
+            if (stopping_) {
+                return false;
+            }
+        }
+        tasks_.push_back(std::move(task));
+    }
+    task_available_.notify_one();
+    return true;
+}
+
+size_t QueryExecutor::GetPendingTaskCount() const {
+    std::lock_guard guard(mutex_);
+    return tasks_.size() + running_tasks_;
+}
+
+size_t QueryExecutor::GetRejectedTaskCount() const {
+    std::lock_guard guard(mutex_);
+    return rejected_tasks_;
+}
+
+size_t QueryExecutor::GetFailedTaskCount() const {
+    std::lock_guard guard(mutex_);
+    return failed_tasks_;
+}
+
+//Потоки запускаются при первой задаче, чтобы сервер без асинхронных запросов их не держал
+void QueryExecutor::StartWorkers() {
+    const size_t thread_count = std::max<size_t>(options_.thread_count, 1);
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back([this] {
+            WorkerLoop();
+        });
+    }
+}
+
+//Исключение задачи не выпускается из потока: иначе std::terminate, а место задачи осталось бы занятым
+void QueryExecutor::WorkerLoop() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        task_available_.wait(lock, [this] {
+            return stopping_ || !tasks_.empty();
+        });
+        if (tasks_.empty()) {
+            return;
+        }
+        std::function<void()> task = std::move(tasks_.front());
+        tasks_.pop_front();
+        ++running_tasks_;
+        lock.unlock();
+        bool is_failed = false;
+        try {
+            task();
+        } catch (...) {
+            is_failed = true;
+        }
+        lock.lock();
+        if (is_failed) {
+            ++failed_tasks_;
+        }
+        --running_tasks_;
+        slot_available_.notify_one();
+    }
+}
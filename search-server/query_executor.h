@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class OverloadPolicy {
+    REJECT,
+    WAIT,
+};
+
+struct QueryExecutorOptions {
+    size_t thread_count = std::thread::hardware_concurrency();
+    size_t max_pending_tasks = 1024;
+    OverloadPolicy overload_policy = OverloadPolicy::REJECT;
+};
+
+class QueryExecutor {
+public:
+    explicit QueryExecutor(QueryExecutorOptions options = {});
+    ~QueryExecutor();
+
+    QueryExecutor(const QueryExecutor&) = delete;
+    QueryExecutor& operator=(const QueryExecutor&) = delete;
+
+    // Исключение из задачи перехватывается и учитывается в GetFailedTaskCount; место задачи освобождается
+    bool TrySubmit(std::function<void()> task);
+
+    size_t GetPendingTaskCount() const;
+    size_t GetRejectedTaskCount() const;
+    size_t GetFailedTaskCount() const;
+
+private:
+    void StartWorkers();
+    void WorkerLoop();
+
+    const QueryExecutorOptions options_;
+    mutable std::mutex mutex_;
+    std::condition_variable task_available_;
+    std::condition_variable slot_available_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> workers_;
+    size_t running_tasks_ = 0;
+    size_t rejected_tasks_ = 0;
+    size_t failed_tasks_ = 0;
+    bool stopping_ = false;
+};
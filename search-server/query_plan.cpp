@@ -0,0 +1,43 @@
+#include "query_plan.h"
+
+using namespace std;
+
+ostream& operator<<(ostream& out, QueryStrategy strategy) {
+    switch (strategy) {
+    case QueryStrategy::SEQUENTIAL:
+        return out << "SEQUENTIAL"s;
+    case QueryStrategy::PARALLEL:
+        return out << "PARALLEL"s;
+    case QueryStrategy::PRUNED:
+        return out << "PRUNED"s;
+    case QueryStrategy::DENSE:
+        return out << "DENSE"s;
+    }
+    return out;
+}
+
+static void PrintTerms(ostream& out, const pmr::vector<PlannedTerm>& terms) {
+    bool is_first = true;
+    for (const PlannedTerm& term : terms) {
+        out << (is_first ? ""s : ", "s) << term.word << " ("s << term.posting_count << ")"s;
+        is_first = false;
+    }
+}
+
+ostream& operator<<(ostream& out, const QueryExplanation& explanation) {
+    const QueryPlan& plan = explanation.plan;
+    out << "strategy: "s << plan.strategy << endl;
+    out << "plus terms: "s;
+    PrintTerms(out, plan.plus_terms);
+    out << endl << "minus terms: "s;
+    PrintTerms(out, plan.minus_terms);
+    out << endl << "dropped terms: "s;
+    bool is_first = true;
+    for (const pmr::string& term : plan.dropped_terms) {
+        out << (is_first ? ""s : ", "s) << term;
+        is_first = false;
+    }
+    out << endl << "postings: estimated "s << plan.estimated_postings << ", actual "s << explanation.actual_postings << endl;
+    out << "documents: "s << explanation.documents.size() << endl;
+    return out;
+}
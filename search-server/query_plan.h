@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "document.h"
+
+enum class QueryStrategy {
+    // Слова по возрастанию длины списков, исключение документов до подсчета релевантности
+    SEQUENTIAL,
+    // Диапазоны id документов на пуле потоков, как partitioned_par
+    PARALLEL,
+    // Как SEQUENTIAL, но когда оставшиеся слова не могут ввести новый документ в лучшие,
+    // они только уточняют релевантность уже найденных
+    PRUNED,
+    // Релевантность всех документов накапливается векторными ядрами в плотном массиве float,
+    // лучшие документы пересчитываются точно по прямому индексу
+    DENSE,
+};
+
+struct PlannedTerm {
+    // Слово индекса
+    std::string_view word;
+    size_t posting_count = 0;
+};
+
+// План строится на арене запроса; план в QueryExplanation копируется на общую кучу
+struct QueryPlan {
+    QueryPlan() = default;
+    explicit QueryPlan(std::pmr::memory_resource* resource)
+        : plus_terms(resource)
+        , minus_terms(resource)
+        , dropped_terms(resource) {
+    }
+
+    QueryStrategy strategy = QueryStrategy::SEQUENTIAL;
+    // По возрастанию числа документов
+    std::pmr::vector<PlannedTerm> plus_terms;
+    std::pmr::vector<PlannedTerm> minus_terms;
+    // Слова запроса, которых нет в индексе
+    std::pmr::vector<std::pmr::string> dropped_terms;
+    size_t estimated_postings = 0;
+};
+
+struct QueryExplanation {
+    QueryPlan plan;
+    size_t actual_postings = 0;
+    std::vector<Document> documents;
+};
+
+std::ostream& operator<<(std::ostream& out, QueryStrategy strategy);
+std::ostream& operator<<(std::ostream& out, const QueryExplanation& explanation);
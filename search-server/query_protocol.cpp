@@ -0,0 +1,121 @@
+#include "query_protocol.h"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+const size_t FRAME_HEADER_SIZE = sizeof(uint32_t);
+const size_t MESSAGE_HEADER_SIZE = sizeof(uint32_t) + 2 * sizeof(uint8_t) + sizeof(uint16_t);
+const size_t DOCUMENT_SIZE = 2 * sizeof(int32_t) + sizeof(double);
+
+template <typename T>
+static void PutValue(string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+static T GetValue(string_view& in) {
+    T value;
+    memcpy(&value, in.data(), sizeof(value));
+    in.remove_prefix(sizeof(value));
+    return value;
+}
+
+static void AppendFrame(string& out, uint32_t request_id, uint8_t code, uint16_t count, string_view body) {
+    const size_t length = MESSAGE_HEADER_SIZE + body.size();
+    if (length > MAX_FRAME_SIZE) {
+        throw invalid_argument("Frame is too long"s);
+    }
+    PutValue(out, static_cast<uint32_t>(length));
+    PutValue(out, request_id);
+    PutValue(out, code);
+    PutValue(out, uint8_t{0});
+    PutValue(out, count);
+    out.append(body);
+}
+
+//Выделение кадра: message получает содержимое после длины
+static size_t ExtractFrame(string_view data, string_view& message) {
+    if (data.size() < FRAME_HEADER_SIZE) {
+        return 0;
+    }
+    const uint32_t length = GetValue<uint32_t>(data);
+    if (length > MAX_FRAME_SIZE || length < MESSAGE_HEADER_SIZE) {
+        throw invalid_argument("Invalid frame length"s);
+    }
+    if (data.size() < length) {
+        return 0;
+    }
+    message = data.substr(0, length);
+    return FRAME_HEADER_SIZE + length;
+}
+
+void AppendRequest(string& out, const QueryRequest& request) {
+    AppendFrame(out, request.request_id, static_cast<uint8_t>(request.status), request.top_k, request.query);
+}
+
+void AppendResponse(string& out, const QueryResponse& response) {
+    if (!response.error.empty()) {
+        AppendFrame(out, response.request_id, 1, 0, response.error);
+        return;
+    }
+    string body;
+    body.reserve(response.documents.size() * DOCUMENT_SIZE);
+    for (const Document& document : response.documents) {
+        PutValue(body, static_cast<int32_t>(document.id));
+        PutValue(body, document.relevance);
+        PutValue(body, static_cast<int32_t>(document.rating));
+    }
+    AppendFrame(out, response.request_id, 0, static_cast<uint16_t>(response.documents.size()), body);
+}
+
+size_t ParseRequest(string_view data, QueryRequest& request) {
+    string_view message;
+    const size_t frame_size = ExtractFrame(data, message);
+    if (frame_size == 0) {
+        return 0;
+    }
+    request.request_id = GetValue<uint32_t>(message);
+    const uint8_t status = GetValue<uint8_t>(message);
+    if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+        throw invalid_argument("Invalid document status"s);
+    }
+    request.status = static_cast<DocumentStatus>(status);
+    GetValue<uint8_t>(message);
+    request.top_k = GetValue<uint16_t>(message);
+    request.query.assign(message);
+    return frame_size;
+}
+
+size_t ParseResponse(string_view data, QueryResponse& response) {
+    string_view message;
+    const size_t frame_size = ExtractFrame(data, message);
+    if (frame_size == 0) {
+        return 0;
+    }
+    response.request_id = GetValue<uint32_t>(message);
+    const uint8_t code = GetValue<uint8_t>(message);
+    GetValue<uint8_t>(message);
+    const uint16_t count = GetValue<uint16_t>(message);
+    response.documents.clear();
+    response.error.clear();
+    if (code != 0) {
+        response.error.assign(message);
+        if (response.error.empty()) {
+            response.error = "Unknown error"s;
+        }
+        return frame_size;
+    }
+    if (message.size() != count * DOCUMENT_SIZE) {
+        throw invalid_argument("Invalid response body"s);
+    }
+    response.documents.reserve(count);
+    for (uint16_t i = 0; i < count; ++i) {
+        const int32_t id = GetValue<int32_t>(message);
+        const double relevance = GetValue<double>(message);
+        const int32_t rating = GetValue<int32_t>(message);
+        response.documents.emplace_back(id, relevance, rating);
+    }
+    return frame_size;
+}
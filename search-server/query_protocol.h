@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "document.h"
+
+// Кадры протокола начинаются с u32 длины остатка кадра. Запрос: u32 request_id, u8 статус, u8 резерв,
+// u16 K, текст запроса. Ответ: u32 request_id, u8 код ошибки, u8 резерв, u16 число документов,
+// документы по 16 байт (i32 id, f64 relevance, i32 rating) или текст ошибки.
+// Числа записываются в порядке байт платформы: клиент и сервер работают на одной машине.
+const size_t MAX_FRAME_SIZE = 1 << 20;
+
+struct QueryRequest {
+    uint32_t request_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    uint16_t top_k = 0;
+    std::string query;
+};
+
+struct QueryResponse {
+    uint32_t request_id = 0;
+    // Пустая строка - запрос выполнен
+    std::string error;
+    std::vector<Document> documents;
+};
+
+void AppendRequest(std::string& out, const QueryRequest& request);
+void AppendResponse(std::string& out, const QueryResponse& response);
+
+// Возвращают длину разобранного кадра или 0, если кадр пришел не целиком.
+// Кадр длиннее MAX_FRAME_SIZE или с неверным содержимым - std::invalid_argument.
+size_t ParseRequest(std::string_view data, QueryRequest& request);
+size_t ParseResponse(std::string_view data, QueryResponse& response);
@@ -4,13 +4,13 @@ using namespace std;
 
 void RemoveDuplicates(SearchServer& search_server) {
     set<int> duplicates;
-    map<set<string>, int> docs;
+    // Набор слов документа - упорядоченные id слов из прямого индекса, строки не копируются
+    map<vector<int>, int> docs;
     for (auto id = search_server.begin(); id != search_server.end(); ++id) {
-        const auto& doc = search_server.GetWordFrequencies(*id);
-        set<string> doc_words;
-
-        for (const auto& [word, _] : doc) {
-            doc_words.insert(word);
+        const auto doc = search_server.GetWordFrequencies(*id);
+        vector<int> doc_words(doc.size());
+        for (size_t i = 0; i < doc.size(); ++i) {
+            doc_words[i] = doc.GetTermFrequencies()[i].term_id;
         }
         if (docs.count(doc_words)) {
             
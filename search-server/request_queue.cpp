@@ -16,6 +16,14 @@ std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query)
         AddRequest(result.size());
         return result;
     }
+int RequestQueue::AddCountRequest(const std::string& raw_query, DocumentStatus status) {
+    const int document_count = search_server_.CountDocuments(raw_query, status);
+    AddRequest(document_count);
+    return document_count;
+}
+int RequestQueue::AddCountRequest(const std::string& raw_query) {
+    return AddCountRequest(raw_query, DocumentStatus::ACTUAL);
+}
     int RequestQueue::GetNoResultRequests() const {
         return no_results_requests_;}
 
@@ -23,6 +23,16 @@ public:
 
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
     std::vector<Document> AddFindRequest(const std::string& raw_query);
+
+    // Запрос только числа документов (SearchServer::CountDocuments), без подсчета релевантности
+    template <typename DocumentPredicate>
+    int AddCountRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+        const int document_count = search_server_.CountDocuments(raw_query, document_predicate);
+        AddRequest(document_count);
+        return document_count;
+    }
+    int AddCountRequest(const std::string& raw_query, DocumentStatus status);
+    int AddCountRequest(const std::string& raw_query);
     int GetNoResultRequests() const;
 
 private:
@@ -0,0 +1,105 @@
+#include "scoring_kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCORING_KERNELS_AVX2 1
+#include <immintrin.h>
+#endif
+
+static void AccumulateLinearScoresScalar(const int* ordinals, const float* term_freqs, size_t count, float weight, float* scores) {
+    for (size_t i = 0; i < count; ++i) {
+        scores[ordinals[i]] += weight * term_freqs[i];
+    }
+}
+
+static void AccumulateBm25ScoresScalar(const int* ordinals, const float* term_freqs, size_t count, float inverse_document_freq,
+                                       float k1, float constant_norm, float length_norm, const double* document_lengths, float* scores) {
+    const float numerator_scale = inverse_document_freq * (k1 + 1.0f);
+    for (size_t i = 0; i < count; ++i) {
+        const float length = static_cast<float>(document_lengths[ordinals[i]]);
+        const float term_count = term_freqs[i] * length;
+        scores[ordinals[i]] += numerator_scale * term_count / (term_count + constant_norm + length_norm * length);
+    }
+}
+
+#ifdef SCORING_KERNELS_AVX2
+
+__attribute__((target("avx2,fma")))
+static void StoreScores(const int* ordinals, __m256 values, float* scores) {
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, values);
+    for (int lane = 0; lane < 8; ++lane) {
+        scores[ordinals[lane]] = lanes[lane];
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void AccumulateLinearScoresAvx2(const int* ordinals, const float* term_freqs, size_t count, float weight, float* scores) {
+    const __m256 weights = _mm256_set1_ps(weight);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i indexes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ordinals + i));
+        const __m256 accumulated = _mm256_i32gather_ps(scores, indexes, sizeof(float));
+        const __m256 freqs = _mm256_loadu_ps(term_freqs + i);
+        StoreScores(ordinals + i, _mm256_fmadd_ps(freqs, weights, accumulated), scores);
+    }
+    AccumulateLinearScoresScalar(ordinals + i, term_freqs + i, count - i, weight, scores);
+}
+
+__attribute__((target("avx2,fma")))
+static void AccumulateBm25ScoresAvx2(const int* ordinals, const float* term_freqs, size_t count, float inverse_document_freq,
+                                     float k1, float constant_norm, float length_norm, const double* document_lengths, float* scores) {
+    const __m256 numerator_scale = _mm256_set1_ps(inverse_document_freq * (k1 + 1.0f));
+    const __m256 constant_norms = _mm256_set1_ps(constant_norm);
+    const __m256 length_norms = _mm256_set1_ps(length_norm);
+    const __m256d all_lanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i indexes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ordinals + i));
+        const __m128 low_lengths = _mm256_cvtpd_ps(_mm256_mask_i32gather_pd(
+            _mm256_setzero_pd(), document_lengths, _mm256_castsi256_si128(indexes), all_lanes, sizeof(double)));
+        const __m128 high_lengths = _mm256_cvtpd_ps(_mm256_mask_i32gather_pd(
+            _mm256_setzero_pd(), document_lengths, _mm256_extracti128_si256(indexes, 1), all_lanes, sizeof(double)));
+        const __m256 lengths = _mm256_insertf128_ps(_mm256_castps128_ps256(low_lengths), high_lengths, 1);
+        const __m256 term_counts = _mm256_mul_ps(_mm256_loadu_ps(term_freqs + i), lengths);
+        const __m256 denominators = _mm256_fmadd_ps(length_norms, lengths, _mm256_add_ps(term_counts, constant_norms));
+        const __m256 term_scores = _mm256_div_ps(_mm256_mul_ps(numerator_scale, term_counts), denominators);
+        const __m256 accumulated = _mm256_i32gather_ps(scores, indexes, sizeof(float));
+        StoreScores(ordinals + i, _mm256_add_ps(accumulated, term_scores), scores);
+    }
+    AccumulateBm25ScoresScalar(ordinals + i, term_freqs + i, count - i, inverse_document_freq, k1, constant_norm, length_norm,
+                               document_lengths, scores);
+}
+
+#endif
+
+bool HasVectorScoringKernels() {
+#ifdef SCORING_KERNELS_AVX2
+    static const bool has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return has_avx2;
+#else
+    return false;
+#endif
+}
+
+void AccumulateLinearScores(const int* ordinals, const float* term_freqs, size_t count, float weight, float* scores) {
+#ifdef SCORING_KERNELS_AVX2
+    if (HasVectorScoringKernels()) {
+        AccumulateLinearScoresAvx2(ordinals, term_freqs, count, weight, scores);
+        return;
+    }
+#endif
+    AccumulateLinearScoresScalar(ordinals, term_freqs, count, weight, scores);
+}
+
+void AccumulateBm25Scores(const int* ordinals, const float* term_freqs, size_t count, float inverse_document_freq,
+                          float k1, float constant_norm, float length_norm, const double* document_lengths, float* scores) {
+#ifdef SCORING_KERNELS_AVX2
+    if (HasVectorScoringKernels()) {
+        AccumulateBm25ScoresAvx2(ordinals, term_freqs, count, inverse_document_freq, k1, constant_norm, length_norm,
+                                 document_lengths, scores);
+        return;
+    }
+#endif
+    AccumulateBm25ScoresScalar(ordinals, term_freqs, count, inverse_document_freq, k1, constant_norm, length_norm,
+                               document_lengths, scores);
+}
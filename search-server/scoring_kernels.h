@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+// Ядра плотного накопления релевантности: scores индексируется порядковым номером документа.
+// Номера в одном вызове не повторяются (это записи одного слова), поэтому порции по 8 записей
+// собираются gather-загрузкой и записываются обратно без конфликтов. При наличии AVX2 и FMA
+// выбирается векторная версия, иначе скалярная.
+
+// scores[ordinals[i]] += weight * term_freqs[i]
+void AccumulateLinearScores(const int* ordinals, const float* term_freqs, size_t count, float weight, float* scores);
+
+// scores[o] += idf * (k1 + 1) * c / (c + constant_norm + length_norm * length[o]), c = term_freq * length[o]
+void AccumulateBm25Scores(const int* ordinals, const float* term_freqs, size_t count, float inverse_document_freq,
+                          float k1, float constant_norm, float length_norm, const double* document_lengths, float* scores);
+
+bool HasVectorScoringKernels();
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "scoring_kernels.h"
+
+#include <cmath>
+#include <cstddef>
+
+struct CorpusStatistics {
+    int document_count = 0;
+    double average_document_length = 0.0;
+};
+
+// Модели ранжирования подставляются в FindTopDocuments шаблонным параметром,
+// поэтому вызовы ComputeTermScore во внутреннем цикле встраиваются без виртуальных вызовов.
+class TfIdfScoring {
+public:
+    explicit TfIdfScoring(const CorpusStatistics& statistics)
+        : document_count_(statistics.document_count) {
+    }
+
+    double ComputeInverseDocumentFreq(int document_freq) const {
+        return std::log(document_count_ * 1.0 / document_freq);
+    }
+
+    double ComputeTermScore(double term_freq, double inverse_document_freq, double /*document_length*/) const {
+        return term_freq * inverse_document_freq;
+    }
+
+    // Наибольший вклад слова в любой документ при наибольшем term_freq этого слова
+    double ComputeTermScoreUpperBound(double max_term_freq, double inverse_document_freq) const {
+        return max_term_freq * inverse_document_freq;
+    }
+
+    // Плотное накопление в float по порядковым номерам документов для стратегии DENSE
+    void AccumulateScores(const int* ordinals, const float* term_freqs, size_t count, double inverse_document_freq,
+                          const double* /*document_lengths*/, float* scores) const {
+        AccumulateLinearScores(ordinals, term_freqs, count, static_cast<float>(inverse_document_freq), scores);
+    }
+
+private:
+    int document_count_;
+};
+
+class Bm25Scoring {
+public:
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+
+    explicit Bm25Scoring(const CorpusStatistics& statistics)
+        : document_count_(statistics.document_count)
+        , constant_norm_(K1 * (1.0 - B))
+        , length_norm_(statistics.average_document_length > 0.0 ? K1 * B / statistics.average_document_length : 0.0) {
+    }
+
+    double ComputeInverseDocumentFreq(int document_freq) const {
+        return std::log(1.0 + (document_count_ - document_freq + 0.5) / (document_freq + 0.5));
+    }
+
+    // term_freq в индексе нормирован на длину документа, поэтому число вхождений восстанавливается умножением
+    double ComputeTermScore(double term_freq, double inverse_document_freq, double document_length) const {
+        const double term_count = term_freq * document_length;
+        return inverse_document_freq * term_count * (K1 + 1.0)
+            / (term_count + constant_norm_ + length_norm_ * document_length);
+    }
+
+    // При term_count = term_freq * document_length вклад растет с длиной документа и ограничен пределом
+    double ComputeTermScoreUpperBound(double max_term_freq, double inverse_document_freq) const {
+        return inverse_document_freq * (K1 + 1.0) * max_term_freq / (max_term_freq + length_norm_);
+    }
+
+    void AccumulateScores(const int* ordinals, const float* term_freqs, size_t count, double inverse_document_freq,
+                          const double* document_lengths, float* scores) const {
+        AccumulateBm25Scores(ordinals, term_freqs, count, static_cast<float>(inverse_document_freq), static_cast<float>(K1),
+                             static_cast<float>(constant_norm_), static_cast<float>(length_norm_), document_lengths, scores);
+    }
+
+private:
+    int document_count_;
+    double constant_norm_;
+    double length_norm_;
+};
@@ -0,0 +1,438 @@
+#include "search_cluster.h"
+
+#include "query_protocol.h"
+#include "search_server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Кадр: u32 длина и тело. Тело запроса начинается с u8 типа, тело ответа - с u8 кода (0 - успех, иначе текст ошибки).
+// ADD: i32 id, u8 статус, u32 число оценок, i32 оценки, текст. REMOVE: i32 id. STATISTICS: текст запроса,
+// ответ - статистика. SEARCH: u8 модель, u8 статус, статистика, текст запроса; ответ - u32 число документов и документы.
+// Статистика: i32 число документов, f64 суммарная длина, u32 число слов, для каждого слова u32 длина, слово, i32 частота.
+enum class MessageType : uint8_t {
+    ADD_DOCUMENT,
+    REMOVE_DOCUMENT,
+    STATISTICS,
+    SEARCH,
+};
+
+template <typename T>
+static void PutValue(string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+static T GetValue(string_view& in) {
+    if (in.size() < sizeof(T)) {
+        throw invalid_argument("Truncated cluster message"s);
+    }
+    T value;
+    memcpy(&value, in.data(), sizeof(value));
+    in.remove_prefix(sizeof(value));
+    return value;
+}
+
+static string MakeFrame(string_view body) {
+    if (body.size() > MAX_FRAME_SIZE) {
+        throw invalid_argument("Frame is too long"s);
+    }
+    string frame;
+    frame.reserve(sizeof(uint32_t) + body.size());
+    PutValue(frame, static_cast<uint32_t>(body.size()));
+    frame.append(body);
+    return frame;
+}
+
+static void PutStatistics(string& out, const QueryStatistics& statistics) {
+    PutValue(out, static_cast<int32_t>(statistics.document_count));
+    PutValue(out, statistics.total_document_length);
+    PutValue(out, static_cast<uint32_t>(statistics.document_freqs.size()));
+    for (const auto& [word, document_freq] : statistics.document_freqs) {
+        PutValue(out, static_cast<uint32_t>(word.size()));
+        out.append(word);
+        PutValue(out, static_cast<int32_t>(document_freq));
+    }
+}
+
+static QueryStatistics GetStatistics(string_view& in) {
+    QueryStatistics statistics;
+    statistics.document_count = GetValue<int32_t>(in);
+    statistics.total_document_length = GetValue<double>(in);
+    const uint32_t word_count = GetValue<uint32_t>(in);
+    for (uint32_t i = 0; i < word_count; ++i) {
+        const uint32_t length = GetValue<uint32_t>(in);
+        if (in.size() < length) {
+            throw invalid_argument("Truncated cluster message"s);
+        }
+        string word(in.substr(0, length));
+        in.remove_prefix(length);
+        statistics.document_freqs.emplace(move(word), GetValue<int32_t>(in));
+    }
+    return statistics;
+}
+
+static DocumentStatus GetStatus(string_view& in) {
+    const uint8_t status = GetValue<uint8_t>(in);
+    if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+        throw invalid_argument("Invalid document status"s);
+    }
+    return static_cast<DocumentStatus>(status);
+}
+
+//Запись всего буфера; false, если узел закрыл соединение
+static bool WriteAll(int fd, string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+    return true;
+}
+
+static bool ReadAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t received = read(fd, data, size);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+//Чтение одного кадра в body; false при закрытом соединении или неверной длине
+static bool ReadFrame(int fd, string& body) {
+    uint32_t length = 0;
+    if (!ReadAll(fd, reinterpret_cast<char*>(&length), sizeof(length)) || length > MAX_FRAME_SIZE) {
+        return false;
+    }
+    body.resize(length);
+    return ReadAll(fd, body.data(), length);
+}
+
+//Тело успешного ответа без кода; ошибка узла превращается в исключение
+static string_view GetResponseBody(const string& response) {
+    string_view body = response;
+    if (GetValue<uint8_t>(body) != 0) {
+        throw invalid_argument(string(body));
+    }
+    return body;
+}
+
+//Сравнение документов по релевантности, при равенстве - по рейтингу, как в SearchServer
+static bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (abs(lhs.relevance - rhs.relevance) < MIN_DELTA) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+SearchCluster::SearchCluster(const string& stop_words_text, SearchClusterOptions options)
+    : stop_words_text_(stop_words_text)
+    , options_(options) {
+    if (options_.worker_count == 0) {
+        throw invalid_argument("Cluster needs at least one worker"s);
+    }
+    // Неверные стоп-слова обнаруживаются до запуска узлов
+    const SearchServer stop_words_check(stop_words_text_, options_.case_folding);
+    workers_.resize(options_.worker_count);
+    try {
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            StartWorker(i);
+        }
+    } catch (...) {
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            StopWorker(i);
+        }
+        throw;
+    }
+}
+
+SearchCluster::~SearchCluster() {
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        StopWorker(i);
+    }
+}
+
+void SearchCluster::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    if (document_id < 0) {
+        throw invalid_argument("Invalid document_id"s);
+    }
+    const size_t worker_index = static_cast<size_t>(document_id) % workers_.size();
+    Worker& worker = workers_[worker_index];
+    if (worker.documents.count(document_id) > 0) {
+        throw invalid_argument("Invalid document_id"s);
+    }
+
+    string request;
+    PutValue(request, MessageType::ADD_DOCUMENT);
+    PutValue(request, static_cast<int32_t>(document_id));
+    PutValue(request, static_cast<uint8_t>(status));
+    PutValue(request, static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        PutValue(request, static_cast<int32_t>(rating));
+    }
+    request.append(document);
+    GetResponseBody(Call(worker_index, MakeFrame(request)));
+    worker.documents.emplace(document_id, StoredDocument{ string(document), status, ratings });
+}
+
+void SearchCluster::RemoveDocument(int document_id) {
+    if (document_id < 0) {
+        return;
+    }
+    const size_t worker_index = static_cast<size_t>(document_id) % workers_.size();
+    if (workers_[worker_index].documents.count(document_id) == 0) {
+        return;
+    }
+    string request;
+    PutValue(request, MessageType::REMOVE_DOCUMENT);
+    PutValue(request, static_cast<int32_t>(document_id));
+    GetResponseBody(Call(worker_index, MakeFrame(request)));
+    workers_[worker_index].documents.erase(document_id);
+}
+
+//Сбор статистики со всех узлов, поиск с суммарной статистикой и слияние лучших документов узлов
+vector<Document> SearchCluster::FindTopDocuments(string_view raw_query, DocumentStatus status, Scoring scoring) {
+    string statistics_request;
+    PutValue(statistics_request, MessageType::STATISTICS);
+    statistics_request.append(raw_query);
+
+    QueryStatistics statistics;
+    for (const string& response : Broadcast(MakeFrame(statistics_request))) {
+        string_view body = GetResponseBody(response);
+        const QueryStatistics worker_statistics = GetStatistics(body);
+        statistics.document_count += worker_statistics.document_count;
+        statistics.total_document_length += worker_statistics.total_document_length;
+        for (const auto& [word, document_freq] : worker_statistics.document_freqs) {
+            statistics.document_freqs[word] += document_freq;
+        }
+    }
+
+    string search_request;
+    PutValue(search_request, MessageType::SEARCH);
+    PutValue(search_request, scoring);
+    PutValue(search_request, static_cast<uint8_t>(status));
+    PutStatistics(search_request, statistics);
+    search_request.append(raw_query);
+
+    vector<Document> documents;
+    for (const string& response : Broadcast(MakeFrame(search_request))) {
+        string_view body = GetResponseBody(response);
+        const uint32_t count = GetValue<uint32_t>(body);
+        for (uint32_t i = 0; i < count; ++i) {
+            const int32_t id = GetValue<int32_t>(body);
+            const double relevance = GetValue<double>(body);
+            const int32_t rating = GetValue<int32_t>(body);
+            documents.emplace_back(id, relevance, rating);
+        }
+    }
+    sort(documents.begin(), documents.end(), IsMoreRelevant);
+    if (documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    return documents;
+}
+
+int SearchCluster::GetDocumentCount() const {
+    size_t document_count = 0;
+    for (const Worker& worker : workers_) {
+        document_count += worker.documents.size();
+    }
+    return static_cast<int>(document_count);
+}
+
+size_t SearchCluster::GetWorkerCount() const {
+    return workers_.size();
+}
+
+pid_t SearchCluster::GetWorkerPid(size_t worker_index) const {
+    return workers_.at(worker_index).pid;
+}
+
+size_t SearchCluster::GetRestartCount() const {
+    return restart_count_;
+}
+
+//Запуск процесса узла; дочерний процесс закрывает сокеты других узлов, чтобы они видели закрытие координатора
+void SearchCluster::StartWorker(size_t worker_index) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+        throw system_error(errno, generic_category(), "socketpair"s);
+    }
+    const pid_t pid = fork();
+    if (pid < 0) {
+        const int error = errno;
+        close(fds[0]);
+        close(fds[1]);
+        throw system_error(error, generic_category(), "fork"s);
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        for (const Worker& worker : workers_) {
+            if (worker.fd >= 0) {
+                close(worker.fd);
+            }
+        }
+        RunWorker(fds[1], stop_words_text_, options_.case_folding);
+    }
+    close(fds[1]);
+    workers_[worker_index].pid = pid;
+    workers_[worker_index].fd = fds[0];
+}
+
+void SearchCluster::StopWorker(size_t worker_index) {
+    Worker& worker = workers_[worker_index];
+    if (worker.fd >= 0) {
+        close(worker.fd);
+        worker.fd = -1;
+    }
+    if (worker.pid > 0) {
+        int status = 0;
+        while (waitpid(worker.pid, &status, 0) < 0 && errno == EINTR) {
+        }
+        worker.pid = -1;
+    }
+}
+
+//Замена упавшего узла новым процессом и повторная загрузка его документов
+void SearchCluster::RestartWorker(size_t worker_index) {
+    Worker& worker = workers_[worker_index];
+    if (worker.pid > 0) {
+        kill(worker.pid, SIGKILL);
+    }
+    StopWorker(worker_index);
+    StartWorker(worker_index);
+    ++restart_count_;
+
+    for (const auto& [document_id, document] : worker.documents) {
+        string request;
+        PutValue(request, MessageType::ADD_DOCUMENT);
+        PutValue(request, static_cast<int32_t>(document_id));
+        PutValue(request, static_cast<uint8_t>(document.status));
+        PutValue(request, static_cast<uint32_t>(document.ratings.size()));
+        for (const int rating : document.ratings) {
+            PutValue(request, static_cast<int32_t>(rating));
+        }
+        request.append(document.text);
+        string response;
+        if (!WriteAll(worker.fd, MakeFrame(request)) || !ReadFrame(worker.fd, response)) {
+            throw runtime_error("Cluster worker "s + to_string(worker_index) + " failed during restart"s);
+        }
+        GetResponseBody(response);
+    }
+}
+
+string SearchCluster::Call(size_t worker_index, const string& request) {
+    string response;
+    if (WriteAll(workers_[worker_index].fd, request) && ReadFrame(workers_[worker_index].fd, response)) {
+        return response;
+    }
+    RestartWorker(worker_index);
+    if (WriteAll(workers_[worker_index].fd, request) && ReadFrame(workers_[worker_index].fd, response)) {
+        return response;
+    }
+    throw runtime_error("Cluster worker "s + to_string(worker_index) + " failed"s);
+}
+
+//Запрос сначала отправляется всем узлам, затем читаются ответы: узлы выполняют его одновременно
+vector<string> SearchCluster::Broadcast(const string& request) {
+    vector<string> responses(workers_.size());
+    vector<bool> is_failed(workers_.size(), false);
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        is_failed[i] = !WriteAll(workers_[i].fd, request);
+    }
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        if (!is_failed[i]) {
+            is_failed[i] = !ReadFrame(workers_[i].fd, responses[i]);
+        }
+    }
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        if (is_failed[i]) {
+            RestartWorker(i);
+            string response;
+            if (!WriteAll(workers_[i].fd, request) || !ReadFrame(workers_[i].fd, response)) {
+                throw runtime_error("Cluster worker "s + to_string(i) + " failed"s);
+            }
+            responses[i] = move(response);
+        }
+    }
+    return responses;
+}
+
+//Цикл процесса узла: до закрытия сокета координатором
+void SearchCluster::RunWorker(int fd, const string& stop_words_text, CaseFolding case_folding) {
+    try {
+        SearchServer search_server(stop_words_text, case_folding);
+        string request;
+        while (ReadFrame(fd, request)) {
+            string response;
+            try {
+                string_view body = request;
+                const auto type = static_cast<MessageType>(GetValue<uint8_t>(body));
+                string result;
+                if (type == MessageType::ADD_DOCUMENT) {
+                    const int32_t document_id = GetValue<int32_t>(body);
+                    const DocumentStatus status = GetStatus(body);
+                    vector<int> ratings(GetValue<uint32_t>(body));
+                    for (int& rating : ratings) {
+                        rating = GetValue<int32_t>(body);
+                    }
+                    search_server.AddDocument(document_id, body, status, ratings);
+                } else if (type == MessageType::REMOVE_DOCUMENT) {
+                    search_server.RemoveDocument(GetValue<int32_t>(body));
+                } else if (type == MessageType::STATISTICS) {
+                    PutStatistics(result, search_server.GetQueryStatistics(body));
+                } else if (type == MessageType::SEARCH) {
+                    const auto scoring = static_cast<Scoring>(GetValue<uint8_t>(body));
+                    const DocumentStatus status = GetStatus(body);
+                    const QueryStatistics statistics = GetStatistics(body);
+                    const vector<Document> documents = scoring == Scoring::BM25
+                        ? search_server.FindTopDocuments<Bm25Scoring>(body, status, statistics)
+                        : search_server.FindTopDocuments<TfIdfScoring>(body, status, statistics);
+                    PutValue(result, static_cast<uint32_t>(documents.size()));
+                    for (const Document& document : documents) {
+                        PutValue(result, static_cast<int32_t>(document.id));
+                        PutValue(result, document.relevance);
+                        PutValue(result, static_cast<int32_t>(document.rating));
+                    }
+                } else {
+                    throw invalid_argument("Unknown cluster message"s);
+                }
+                PutValue(response, uint8_t{0});
+                response.append(result);
+            } catch (const exception& e) {
+                response.clear();
+                PutValue(response, uint8_t{1});
+                response.append(e.what());
+            }
+            if (!WriteAll(fd, MakeFrame(response))) {
+                break;
+            }
+        }
+    } catch (...) {
+        _exit(1);
+    }
+    _exit(0);
+}
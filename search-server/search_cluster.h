@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "document.h"
+#include "scoring_models.h"
+#include "string_processing.h"
+
+struct SearchClusterOptions {
+    size_t worker_count = 4;
+    CaseFolding case_folding = CaseFolding::NONE;
+};
+
+// Корпус делится между процессами-узлами по document_id % worker_count, у каждого узла свой SearchServer.
+// Координатор связан с узлом парой Unix-сокетов. Запрос выполняется в два шага: узлы присылают статистику
+// по словам запроса, затем ищут с суммарной статистикой, поэтому релевантность совпадает с одним сервером.
+// Координатор хранит копию документов узла, чтобы перезапустить упавший узел и загрузить в него его часть корпуса.
+// Узлы порождаются fork: кластер создается до запуска других потоков программы, методы не потокобезопасны.
+class SearchCluster {
+public:
+    explicit SearchCluster(const std::string& stop_words_text, SearchClusterOptions options = {});
+    ~SearchCluster();
+
+    SearchCluster(const SearchCluster&) = delete;
+    SearchCluster& operator=(const SearchCluster&) = delete;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    template <typename ScoringModel = TfIdfScoring>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+
+    int GetDocumentCount() const;
+    size_t GetWorkerCount() const;
+    pid_t GetWorkerPid(size_t worker_index) const;
+    // Число перезапусков узлов с момента создания кластера
+    size_t GetRestartCount() const;
+
+private:
+    enum class Scoring : uint8_t {
+        TF_IDF,
+        BM25,
+    };
+
+    struct StoredDocument {
+        std::string text;
+        DocumentStatus status;
+        std::vector<int> ratings;
+    };
+
+    struct Worker {
+        pid_t pid = -1;
+        int fd = -1;
+        std::map<int, StoredDocument> documents;
+    };
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, Scoring scoring);
+
+    void StartWorker(size_t worker_index);
+    void StopWorker(size_t worker_index);
+    void RestartWorker(size_t worker_index);
+    // Запрос к одному узлу; упавший узел перезапускается и получает запрос повторно
+    std::string Call(size_t worker_index, const std::string& request);
+    // Запрос ко всем узлам сразу, ответы в порядке узлов
+    std::vector<std::string> Broadcast(const std::string& request);
+    [[noreturn]] static void RunWorker(int fd, const std::string& stop_words_text, CaseFolding case_folding);
+
+    const std::string stop_words_text_;
+    const SearchClusterOptions options_;
+    std::vector<Worker> workers_;
+    size_t restart_count_ = 0;
+};
+
+template <typename ScoringModel>
+std::vector<Document> SearchCluster::FindTopDocuments(std::string_view raw_query, DocumentStatus status) {
+    static_assert(std::is_same_v<ScoringModel, TfIdfScoring> || std::is_same_v<ScoringModel, Bm25Scoring>,
+                  "Cluster supports TfIdfScoring and Bm25Scoring");
+    return FindTopDocuments(raw_query, status, std::is_same_v<ScoringModel, Bm25Scoring> ? Scoring::BM25 : Scoring::TF_IDF);
+}
@@ -2,13 +2,13 @@
 
 using std::operator ""s;
 //Конструкторы
-SearchServer::SearchServer(const std::string& stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text))
+SearchServer::SearchServer(const std::string& stop_words_text, CaseFolding case_folding, std::pmr::memory_resource* memory_resource)
+    : SearchServer(SplitIntoWords(stop_words_text), case_folding, memory_resource)
     {
     }
     
-    SearchServer::SearchServer(std::string_view stop_words_text)
-         :SearchServer(SplitIntoWords(stop_words_text))
+    SearchServer::SearchServer(std::string_view stop_words_text, CaseFolding case_folding, std::pmr::memory_resource* memory_resource)
+         :SearchServer(SplitIntoWords(stop_words_text), case_folding, memory_resource)
     {
     }
    
@@ -18,40 +18,111 @@ SearchServer::SearchServer(const std::string& stop_words_text)
         if ((document_id < 0) || (documents_.count(document_id) > 0)) {
             throw std::invalid_argument("Invalid document_id"s);
         }
-    documents_.emplace(document_id, DocumentData{ SearchServer::ComputeAverageRating(ratings), status});
-       
-       document_text_.emplace(document_id, std::string(document));
+    CheckMemoryBudget(document.size());
+    auto& text = document_text_.emplace(document_id, document).first->second;
+    IndexDocument(document_id, text, case_folding_ == CaseFolding::ASCII ? text.data() : nullptr, status, ratings);
+    }
+
+//Принятие отображения во владение; deque не перемещает элементы, поэтому ссылка остается действительной
+const MappedFile& SearchServer::AdoptMappedFile(MappedFile file) {
+    return mapped_files_.emplace_back(std::move(file));
+}
+
+//Добавление документа, текст которого лежит в принятом сервером отображении
+void SearchServer::AddMappedDocument(int document_id, std::string_view document, DocumentStatus status,
+                                     const std::vector<int>& ratings) {
+    if (none_of(mapped_files_.begin(), mapped_files_.end(), [document](const MappedFile& file) {
+            return file.Contains(document);
+        })) {
+        throw std::invalid_argument("Document text is not in a mapped file"s);
+    }
+    if (case_folding_ == CaseFolding::ASCII) {
+        AddDocument(document_id, document, status, ratings);
+        return;
+    }
+    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+        throw std::invalid_argument("Invalid document_id"s);
+    }
+    // Текст остается в отображении и не занимает память индекса
+    CheckMemoryBudget(0);
+    mapped_document_text_.emplace(document_id, document);
+    IndexDocument(document_id, document, nullptr, status, ratings);
+}
+
+//Проверка бюджета памяти перед добавлением added_bytes байт текста
+void SearchServer::CheckMemoryBudget(size_t added_bytes) {
+    if (memory_budget_ > 0 && GetMemoryUsage().GetTotal() + added_bytes > memory_budget_) {
+        if (memory_budget_policy_ == MemoryBudgetPolicy::COMPACT) {
+            Compact();
+        }
+        if (GetMemoryUsage().GetTotal() + added_bytes > memory_budget_) {
+            throw std::length_error("Memory budget exceeded"s);
+        }
+    }
+}
+
+//Индексирование текста документа: прямой и обратный индексы ссылаются в text
+void SearchServer::IndexDocument(int document_id, std::string_view text, char* folded_text, DocumentStatus status,
+                                 const std::vector<int>& ratings) {
+    const int ordinal = static_cast<int>(document_lengths_.size());
+    documents_.emplace(document_id, DocumentData{ SearchServer::ComputeAverageRating(ratings), status, ordinal});
     
-    auto words = SplitIntoWordsNoStop(document_text_.at(document_id));
+    auto words = SplitIntoWordsNoStop(text, folded_text);
+    document_lengths_.push_back(static_cast<double>(words.size()));
+    document_ids_by_ordinal_.push_back(document_id);
+    total_document_length_ += words.size();
  const double inv_word_count = 1.0 / words.size();   
+    std::vector<TermFrequency> term_freqs;
+    term_freqs.reserve(words.size());
     for (auto word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word] += inv_word_count;
+        auto& [index_word, word_freqs] = *word_to_document_freqs_.try_emplace(word).first;
+        word_freqs[document_id] += inv_word_count;
+        const auto [term, is_new_term] = term_ids_.try_emplace(index_word, static_cast<int>(terms_.size()));
+        if (is_new_term) {
+            terms_.push_back(index_word);
+            term_max_freqs_.push_back(0.0);
+            posting_ordinals_.emplace_back();
+            posting_term_freqs_.emplace_back();
+        }
+        term_freqs.push_back({term->second, inv_word_count});
+    }
+    sort(term_freqs.begin(), term_freqs.end(), [](const TermFrequency& lhs, const TermFrequency& rhs) {
+        return lhs.term_id < rhs.term_id;
+    });
+    auto& document_term_freqs = document_to_word_freqs_.emplace_back();
+    for (const TermFrequency& term_freq : term_freqs) {
+        if (!document_term_freqs.empty() && document_term_freqs.back().term_id == term_freq.term_id) {
+            document_term_freqs.back().term_freq += term_freq.term_freq;
+        } else {
+            document_term_freqs.push_back(term_freq);
+        }
+    }
+    document_term_freqs.shrink_to_fit();
+    for (const TermFrequency& term_freq : document_term_freqs) {
+        term_max_freqs_[term_freq.term_id] = std::max(term_max_freqs_[term_freq.term_id], term_freq.term_freq);
+        posting_ordinals_[term_freq.term_id].push_back(ordinal);
+        posting_term_freqs_[term_freq.term_id].push_back(static_cast<float>(term_freq.term_freq));
     }
     
     document_ids_.insert(document_id);     
-  
-    }
-
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(std::execution::seq, raw_query, status);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
-    return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
+std::string_view SearchServer::GetDocumentText(int document_id) const {
+    const auto text = document_text_.find(document_id);
+    if (text != document_text_.end()) {
+        return text->second;
+    }
+    return mapped_document_text_.at(document_id);
 }
 
-
 //Получение частот слов по id документа
-    const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static const std::map<std::string_view, double> empty_result;
-
-    if (document_to_word_freqs_.count(document_id)) {
-        return document_to_word_freqs_.at(document_id);
+    WordFrequenciesView SearchServer::GetWordFrequencies(int document_id) const {
+    const auto document = documents_.find(document_id);
+    if (document == documents_.end()) {
+        return {};
     }
-    else {
-        return empty_result;
-    }      
+    const auto& term_freqs = document_to_word_freqs_[document->second.ordinal];
+    return { term_freqs.data(), term_freqs.data() + term_freqs.size(), terms_.data() };
 }
 //Возврат количества документов
     int SearchServer::GetDocumentCount() const {
@@ -59,25 +130,145 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query)
     }
 
 
-std::set<int>::const_iterator SearchServer::begin() const {
+std::pmr::set<int>::const_iterator SearchServer::begin() const {
     return document_ids_.begin();
 }
 
 
-std::set<int>::const_iterator SearchServer::end() const {
+std::pmr::set<int>::const_iterator SearchServer::end() const {
     return document_ids_.end();
 }
 
+//Точный объем памяти по структурам индекса
+MemoryUsage SearchServer::GetMemoryUsage() const {
+    MemoryUsage usage;
+    usage.word_to_document_freqs = word_to_document_freqs_memory_.GetAllocatedBytes();
+    usage.document_to_word_freqs = document_to_word_freqs_memory_.GetAllocatedBytes();
+    usage.document_text = document_text_memory_.GetAllocatedBytes();
+    usage.documents = documents_memory_.GetAllocatedBytes();
+    usage.document_ids = document_ids_memory_.GetAllocatedBytes();
+    usage.document_lengths = document_lengths_memory_.GetAllocatedBytes();
+    return usage;
+}
+
+void SearchServer::SetMemoryBudget(size_t max_bytes, MemoryBudgetPolicy policy) {
+    memory_budget_ = max_bytes;
+    memory_budget_policy_ = policy;
+}
+
+//Удаление пустых списков документов, записей и текстов удаленных документов
+void SearchServer::Compact() {
+    for (auto it = word_to_document_freqs_.begin(); it != word_to_document_freqs_.end();) {
+        if (it->second.empty()) {
+            const auto term = term_ids_.find(it->first);
+            terms_[term->second] = {};
+            term_ids_.erase(term);
+            it = word_to_document_freqs_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (size_t term_id = 0; term_id < posting_ordinals_.size(); ++term_id) {
+        auto& ordinals = posting_ordinals_[term_id];
+        auto& term_freqs = posting_term_freqs_[term_id];
+        size_t live_count = 0;
+        for (size_t i = 0; i < ordinals.size(); ++i) {
+            if (document_ids_by_ordinal_[ordinals[i]] >= 0) {
+                ordinals[live_count] = ordinals[i];
+                term_freqs[live_count] = term_freqs[i];
+                ++live_count;
+            }
+        }
+        if (live_count < ordinals.size()) {
+            ordinals.resize(live_count);
+            ordinals.shrink_to_fit();
+            term_freqs.resize(live_count);
+            term_freqs.shrink_to_fit();
+        }
+    }
+
+    // Текст удаленного документа может оставаться ключом слова, которое есть в других документах
+    std::vector<std::string_view> removed_texts;
+    for (const auto& [document_id, text] : document_text_) {
+        if (documents_.count(document_id) == 0) {
+            removed_texts.push_back(text);
+        }
+    }
+    for (const auto& [document_id, text] : mapped_document_text_) {
+        if (documents_.count(document_id) == 0) {
+            removed_texts.push_back(text);
+        }
+    }
+    if (removed_texts.empty()) {
+        return;
+    }
+    sort(removed_texts.begin(), removed_texts.end(), [](std::string_view lhs, std::string_view rhs) {
+        return lhs.data() < rhs.data();
+    });
+    const auto points_to_removed_text = [&removed_texts](std::string_view word) {
+        auto it = upper_bound(removed_texts.begin(), removed_texts.end(), word.data(), [](const char* data, std::string_view text) {
+            return data < text.data();
+        });
+        if (it == removed_texts.begin()) {
+            return false;
+        }
+        --it;
+        return word.data() < it->data() + it->size();
+    };
+
+    std::vector<std::string_view> rebound_words;
+    for (const auto& [word, word_freqs] : word_to_document_freqs_) {
+        if (points_to_removed_text(word)) {
+            rebound_words.push_back(word);
+        }
+    }
+    for (const std::string_view word : rebound_words) {
+        auto node = word_to_document_freqs_.extract(word);
+        const int live_document_id = node.mapped().begin()->first;
+        for (const std::string_view live_word : SplitIntoWords(GetDocumentText(live_document_id))) {
+            if (live_word == word) {
+                node.key() = live_word;
+                break;
+            }
+        }
+        auto term = term_ids_.extract(word);
+        terms_[term.mapped()] = node.key();
+        term.key() = node.key();
+        term_ids_.insert(std::move(term));
+        word_to_document_freqs_.insert(std::move(node));
+    }
+
+    for (auto it = document_text_.begin(); it != document_text_.end();) {
+        if (documents_.count(it->first) == 0) {
+            it = document_text_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = mapped_document_text_.begin(); it != mapped_document_text_.end();) {
+        if (documents_.count(it->first) == 0) {
+            it = mapped_document_text_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 //Удаление документа из поискового сервера
     void SearchServer::RemoveDocument(int document_id) {
         
    if (document_ids_.find(document_id) == document_ids_.end()){
         return;
     }   
-        for (auto [word, freq] : document_to_word_freqs_.at(document_id)) {
-        word_to_document_freqs_.at(word).erase(document_id);
+    const int ordinal = documents_.at(document_id).ordinal;
+        for (const TermFrequency& term_freq : document_to_word_freqs_[ordinal]) {
+        word_to_document_freqs_.at(terms_[term_freq.term_id]).erase(document_id);
     }
-    document_to_word_freqs_.erase(document_id);
+    total_document_length_ -= document_lengths_[ordinal];
+    document_to_word_freqs_[ordinal].clear();
+    document_to_word_freqs_[ordinal].shrink_to_fit();
+    document_ids_by_ordinal_[ordinal] = -1;
     document_ids_.erase(document_id);
  documents_.erase(document_id);
 }
@@ -85,6 +276,7 @@ std::set<int>::const_iterator SearchServer::end() const {
 
 //Возврат списка совпавших слов запроса
 SearchServer::ResultMatchDocument SearchServer::MatchDocument( std::string_view raw_query, int document_id) const {
+   const QueryArena::Scope arena;
    const Query query = ParseQuery(raw_query);
 
     std::vector<std::string_view> matched_words;
@@ -95,15 +287,16 @@ SearchServer::ResultMatchDocument SearchServer::MatchDocument( std::string_view
         }
         if (word_to_document_freqs_.at(word).count(document_id)) {
             matched_words.clear();
-             return { {}, documents_.at(document_id).status };
+             return { std::vector<std::string_view>{}, documents_.at(document_id).status };
         }
     }
     for(const std::string_view word : query.plus_words) {
         if (word_to_document_freqs_.count(word) == 0) {
             continue;
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
+        const auto& word_freqs = *word_to_document_freqs_.find(word);
+        if (word_freqs.second.count(document_id)) {
+            matched_words.push_back(word_freqs.first);
         }
     }
     
@@ -125,25 +318,30 @@ SearchServer::ResultMatchDocument SearchServer::MatchDocument(const std::executi
         }
     
     
+    const QueryArena::Scope arena;
     const Query& query = ParseQueryParallel(raw_query);
     
 std::vector<std::string_view> matched_words;
  matched_words.reserve(query.plus_words.size()); 
-    const auto& word_freqs = document_to_word_freqs_.at(document_id);
+    const auto& term_freqs = document_to_word_freqs_[documents_.at(document_id).ordinal];
     
     if (any_of(policy,query.minus_words.begin(),
                     query.minus_words.end(),
-                    [&word_freqs](const std::string_view word) {
-                        return word_freqs.count(word) > 0;
+                    [this, &term_freqs](const std::string_view word) {
+                        return !FindDocumentWord(term_freqs, word).empty();
                     })) {
-        return { {}, documents_.at(document_id).status };
+        return { std::vector<std::string_view>{}, documents_.at(document_id).status };
     }
 
-    copy_if( policy, query.plus_words.begin(),
-                 query.plus_words.end(),
-                 back_inserter(matched_words),
-                 [&word_freqs](const std::string_view word) {
-                     return word_freqs.count(word) > 0;
+    // Слова возвращаются из индекса: слова запроса могут жить в его временном буфере
+    std::pmr::vector<std::string_view> found_words(query.plus_words.size(), QueryArena::GetResource());
+    transform(policy, query.plus_words.begin(), query.plus_words.end(), found_words.begin(),
+                 [this, &term_freqs](const std::string_view word) {
+                     return FindDocumentWord(term_freqs, word);
+                 });
+    copy_if(found_words.begin(), found_words.end(), back_inserter(matched_words),
+                 [](const std::string_view word) {
+                     return !word.empty();
                  });
 
 sort(policy, matched_words.begin(), matched_words.end());
@@ -153,29 +351,63 @@ sort(policy, matched_words.begin(), matched_words.end());
     return { matched_words, documents_.at(document_id).status };
 } 
 
-//Проверка входящего слова на принадлежность к стоп-словам
-  bool SearchServer::IsStopWord( std::string_view word) const {
-        return stop_words_.count(word) > 0;
+SearchServer::ResultMatchDocument SearchServer::MatchDocument(const PoolExecutionPolicy& policy, std::string_view raw_query, int document_id) const {
+    if ((document_id < 0) || (documents_.count(document_id) == 0)) {
+        throw std::invalid_argument("document_id out of range"s);
     }
 
-//Проверка на отсутствие в слове спецсимволов
-    bool SearchServer::IsValidWord(std::string_view word) {
-        return std::none_of(word.begin(), word.end(), [](char c) {
-            return c >= '\0' && c < ' ';
-        });
+    const QueryArena::Scope arena;
+    const Query query = ParseQueryParallel(raw_query);
+    const auto& term_freqs = document_to_word_freqs_[documents_.at(document_id).ordinal];
+
+    std::atomic<bool> has_minus_word = false;
+    thread_pool_->ParallelFor(query.minus_words.size(), [this, &query, &term_freqs, &has_minus_word](size_t index) {
+        if (!FindDocumentWord(term_freqs, query.minus_words[index]).empty()) {
+            has_minus_word = true;
+        }
+    });
+    if (has_minus_word) {
+        return { std::vector<std::string_view>{}, documents_.at(document_id).status };
     }
 
-//Разбивка строки запроса на вектор слов, исключая стоп-слова
-    std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
+    std::pmr::vector<std::string_view> found_words(query.plus_words.size(), QueryArena::GetResource());
+    thread_pool_->ParallelFor(query.plus_words.size(), [this, &query, &term_freqs, &found_words](size_t index) {
+        found_words[index] = FindDocumentWord(term_freqs, query.plus_words[index]);
+    });
+
+    std::vector<std::string_view> matched_words;
+    for (const std::string_view word : found_words) {
+        if (!word.empty()) {
+            matched_words.push_back(word);
+        }
+    }
+    sort(matched_words.begin(), matched_words.end());
+    matched_words.erase(unique(matched_words.begin(), matched_words.end()), matched_words.end());
+    return { matched_words, documents_.at(document_id).status };
+}
+
+//Поиск слова в прямом индексе документа: id слова по словарю, затем двоичный поиск по id
+std::string_view SearchServer::FindDocumentWord(const std::pmr::vector<TermFrequency>& term_freqs, std::string_view word) const {
+    const auto term = term_ids_.find(word);
+    if (term == term_ids_.end()) {
+        return {};
+    }
+    const auto it = lower_bound(term_freqs.begin(), term_freqs.end(), term->second, [](const TermFrequency& term_freq, int term_id) {
+        return term_freq.term_id < term_id;
+    });
+    if (it == term_freqs.end() || it->term_id != term->second) {
+        return {};
+    }
+    return terms_[term->second];
+}
+
+//Разбивка текста документа на слова без стоп-слов; регистр приводится прямо в сохраненной копии
+    std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text, char* folded_text) const {
     	std::vector<std::string_view> words;
-        for (const std::string_view word : SplitIntoWords(text)) {
-            if (!IsValidWord(word)) {
-                throw std::invalid_argument("Недопустимое слово"s);
-            }
-            if (!IsStopWord(word)) {
+        ForEachNormalizedWord(stop_words_, text, folded_text, false,
+            [&words](std::string_view word, bool) {
                 words.push_back(word);
-            }
-        }
+        });
         return words;
     }
 
@@ -188,38 +420,10 @@ sort(policy, matched_words.begin(), matched_words.end());
         return rating_sum / static_cast<int>(ratings.size());
     }
 
-//Удалеие "-" у минус-слов
-    SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const {
-        if (text.empty()) {
-            throw std::invalid_argument("Пустое слово"s);
-        }
-        std::string_view word = text;
-        bool is_minus = false;
-        if (word[0] == '-') {
-            is_minus = true;
-            word = word.substr(1);
-        }
-        if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
-            throw std::invalid_argument("Наличие более одного минуса"s);
-        }
-        return {word, is_minus, IsStopWord(word)};
-    }
-
 //Создание списков плюс- и минус-слов
 
    SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
-        Query result;
-    for (const std::string_view word : SplitIntoWords(text)) {
-        const QueryWord query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
-            }
-            else {
-                result.plus_words.push_back(query_word.data);
-            }
-        }
-    }
+        Query result = ParseQueryParallel(text);
     sort(result.minus_words.begin(), result.minus_words.end());
     auto itm = unique(result.minus_words.begin(), result.minus_words.end());
     result.minus_words.resize(distance(result.minus_words.begin(), itm));
@@ -232,22 +436,258 @@ sort(policy, matched_words.begin(), matched_words.end());
     }
     
 SearchServer::Query SearchServer::ParseQueryParallel(std::string_view text) const {
-    Query result;
-    for (const std::string_view word : SplitIntoWords(text)) {
-        const QueryWord query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
+    Query result(QueryArena::GetResource());
+    char* folded_text = nullptr;
+    if (case_folding_ == CaseFolding::ASCII) {
+        result.folded_text.resize(text.size());
+        folded_text = result.folded_text.data();
+    }
+    ForEachNormalizedWord(stop_words_, text, folded_text, true, [this, &result](std::string_view word, bool is_minus) {
+        std::pmr::vector<std::string_view>& words = is_minus ? result.minus_words : result.plus_words;
+        if (word.back() == '*') {
+            if (word.size() == 1) {
+                throw std::invalid_argument("Пустой префикс"s);
             }
-            else {
-                result.plus_words.push_back(query_word.data);
+            ExpandPrefix(word.substr(0, word.size() - 1),
+                         is_minus ? std::numeric_limits<size_t>::max() : static_cast<size_t>(MAX_PREFIX_EXPANSIONS), words);
+        }
+        else {
+            words.push_back(word);
+        }
+    });
+    return result;
+}
+
+//Подстановка слов индекса с заданным префиксом. Ключи индекса упорядочены,
+//поэтому перебор начинается с lower_bound и занимает время, пропорциональное числу просмотренных слов
+void SearchServer::ExpandPrefix(std::string_view prefix, size_t max_visited, std::pmr::vector<std::string_view>& words) const {
+    size_t visited_count = 0;
+    for (auto it = word_to_document_freqs_.lower_bound(prefix);
+         it != word_to_document_freqs_.end() && it->first.substr(0, prefix.size()) == prefix && visited_count < max_visited;
+         ++it, ++visited_count) {
+        if (!it->second.empty()) {
+            words.push_back(it->first);
+        }
+    }
+}
+
+//Пересечение автомата Левенштейна с упорядоченными словами индекса. Строки автомата для общего
+//префикса соседних слов переиспользуются, а при тупиковом префиксе поиск перескакивает
+//через все слова с этим префиксом
+std::vector<std::pair<std::string_view, int>> SearchServer::ExpandFuzzyWord(std::string_view word, int max_edits) const {
+    const LevenshteinAutomaton automaton(word, max_edits);
+    const size_t state_size = automaton.GetStateSize();
+    // states[k * state_size] - состояние после первых k символов текущего слова
+    std::vector<int> states(state_size);
+    automaton.Start(states.data());
+    std::vector<std::pair<std::string_view, int>> result;
+
+    std::string_view previous_term;
+    size_t state_count = 1;
+    std::string next_prefix;
+    auto it = word_to_document_freqs_.begin();
+    while (it != word_to_document_freqs_.end()) {
+        const std::string_view term = it->first;
+        size_t common_size = 0;
+        while (common_size < previous_term.size() && common_size < term.size() && common_size + 1 < state_count
+               && previous_term[common_size] == term[common_size]) {
+            ++common_size;
+        }
+        state_count = common_size + 1;
+        if (states.size() < (term.size() + 1) * state_size) {
+            states.resize((term.size() + 1) * state_size);
+        }
+
+        size_t dead_size = 0;
+        for (size_t i = common_size; i < term.size(); ++i) {
+            const int* state = states.data() + i * state_size;
+            if (automaton.Step(state, term[i], states.data() + (i + 1) * state_size) > max_edits) {
+                dead_size = i + 1;
+                break;
             }
+            ++state_count;
+        }
+
+        if (dead_size == 0) {
+            const int* state = states.data() + term.size() * state_size;
+            if (automaton.IsMatch(state) && !it->second.empty()) {
+                result.push_back({ term, automaton.GetDistance(state) });
+            }
+            previous_term = term;
+            ++it;
+            continue;
+        }
+
+        next_prefix.assign(term.substr(0, dead_size));
+        while (!next_prefix.empty() && static_cast<unsigned char>(next_prefix.back()) == 0xFF) {
+            next_prefix.pop_back();
+        }
+        if (next_prefix.empty()) {
+            break;
+        }
+        next_prefix.back() = static_cast<char>(static_cast<unsigned char>(next_prefix.back()) + 1);
+        previous_term = term.substr(0, dead_size - 1);
+        // Обычно следующее подходящее слово недалеко, поэтому сначала несколько шагов вперед, потом поиск в дереве
+        int step_count = 0;
+        while (it != word_to_document_freqs_.end() && it->first < next_prefix && step_count < SEEK_LINEAR_STEPS) {
+            ++it;
+            ++step_count;
+        }
+        if (it != word_to_document_freqs_.end() && it->first < next_prefix) {
+            it = word_to_document_freqs_.lower_bound(next_prefix);
         }
     }
     return result;
 }
 
-//Вычисление IDF слова
-    double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
-        return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+//Замена исполнителя асинхронных запросов; старый дожидается своих задач
+    void SearchServer::SetQueryExecutorOptions(QueryExecutorOptions options) {
+        query_executor_ = std::make_unique<QueryExecutor>(options);
+    }
+
+    const QueryExecutor& SearchServer::GetQueryExecutor() const {
+        return *query_executor_;
+    }
+
+//Замена пула потоков для параллельных перегрузок с pool_par
+    void SearchServer::SetThreadPoolOptions(ThreadPoolOptions options) {
+        thread_pool_ = std::make_unique<ThreadPool>(options);
+    }
+
+    ThreadPool& SearchServer::GetThreadPool() const {
+        return *thread_pool_;
+    }
+
+    std::vector<WorkerStats> SearchServer::GetThreadPoolStats() const {
+        return thread_pool_->GetWorkerStats();
+    }
+
+//Подсчет и проверка наличия документов со статусом status
+int SearchServer::CountDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return CountDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+    });
+}
+
+bool SearchServer::HasMatches(std::string_view raw_query, DocumentStatus status) const {
+    return HasMatches(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+        return document_status == status;
+    });
+}
+
+//Сравнение документов по релевантности, при равенстве - по рейтингу
+    bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs) {
+        if (std::abs(lhs.relevance - rhs.relevance) < MIN_DELTA) {
+            return lhs.rating > rhs.rating;
+        }
+        return lhs.relevance > rhs.relevance;
+    }
+
+//Копия лучших документов с арены запроса в результат, который переживает арену
+std::vector<Document> SearchServer::CopyTopDocuments(const std::pmr::vector<Document>& sorted_documents) {
+    const size_t count = std::min(sorted_documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    return std::vector<Document>(sorted_documents.begin(), sorted_documents.begin() + count);
+}
+
+//План запроса: пустые слова отбрасываются, остальные упорядочиваются по длине списка документов
+QueryPlan SearchServer::BuildQueryPlan(const Query& query, bool allow_parallel) const {
+    QueryPlan plan(QueryArena::GetResource());
+    const auto add_terms = [this, &plan](const std::pmr::vector<std::string_view>& words, std::pmr::vector<PlannedTerm>& terms) {
+        for (const std::string_view word : words) {
+            const auto word_freqs = word_to_document_freqs_.find(word);
+            if (word_freqs == word_to_document_freqs_.end() || word_freqs->second.empty()) {
+                plan.dropped_terms.emplace_back(word);
+                continue;
+            }
+            terms.push_back({ word_freqs->first, word_freqs->second.size() });
+        }
+        sort(terms.begin(), terms.end(), [](const PlannedTerm& lhs, const PlannedTerm& rhs) {
+            return lhs.posting_count < rhs.posting_count;
+        });
+    };
+    add_terms(query.plus_words, plan.plus_terms);
+    add_terms(query.minus_words, plan.minus_terms);
+    if (plan.plus_terms.empty()) {
+        plan.minus_terms.clear();
+        return plan;
+    }
+
+    for (const PlannedTerm& term : plan.plus_terms) {
+        plan.estimated_postings += term.posting_count;
+    }
+    // Минус-слова проверяются поиском для каждого нового документа, не больше одного раза на запись плюс-слов
+    plan.estimated_postings += plan.minus_terms.size() * plan.estimated_postings;
+
+    // Отсечение выгодно, когда одно длинное слово перевешивает остальные: его записи только уточняют релевантность
+    size_t plus_postings = 0;
+    for (const PlannedTerm& term : plan.plus_terms) {
+        plus_postings += term.posting_count;
+    }
+    const size_t longest_postings = plan.plus_terms.back().posting_count;
+    const bool is_prunable = plan.plus_terms.size() > 1 && plan.estimated_postings >= PRUNED_MIN_POSTINGS;
+    if (allow_parallel && plan.estimated_postings >= PARALLEL_MIN_POSTINGS && thread_pool_->GetThreadCount() > 1) {
+        plan.strategy = QueryStrategy::PARALLEL;
+    } else if (is_prunable && longest_postings > 2 * (plus_postings - longest_postings)) {
+        plan.strategy = QueryStrategy::PRUNED;
+    } else if (plus_postings >= DENSE_MIN_POSTINGS) {
+        plan.strategy = QueryStrategy::DENSE;
+    } else if (is_prunable) {
+        plan.strategy = QueryStrategy::PRUNED;
+    }
+    return plan;
+}
+
+//Массив релевантностей потока растет вместе с индексом и между запросами остается нулевым
+SearchServer::DenseAccumulator& SearchServer::GetDenseAccumulator(size_t ordinal_count) {
+    thread_local DenseAccumulator accumulator;
+    if (accumulator.scores.size() < ordinal_count) {
+        accumulator.scores.resize(ordinal_count, 0.0f);
+        accumulator.states.resize(ordinal_count, DenseAccumulator::UNTOUCHED);
+    }
+    return accumulator;
+}
+
+void SearchServer::ResetDenseAccumulator(DenseAccumulator& accumulator) {
+    for (const int ordinal : accumulator.touched) {
+        accumulator.scores[ordinal] = 0.0f;
+        accumulator.states[ordinal] = DenseAccumulator::UNTOUCHED;
+    }
+    accumulator.touched.clear();
+}
+
+QueryExplanation SearchServer::Explain(std::string_view raw_query) const {
+    const QueryArena::Scope arena;
+    const Query query = ParseQuery(raw_query);
+    QueryExplanation explanation;
+    // Ресурсы разные, поэтому присваивание копирует план с арены на общую кучу
+    explanation.plan = BuildQueryPlan(query, true);
+    auto matched_documents = FindAllDocuments<TfIdfScoring>(query, explanation.plan,
+        [](int document_id, DocumentStatus status, int rating) {
+            return status == DocumentStatus::ACTUAL;
+    }, explanation.actual_postings);
+    sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+    explanation.documents = CopyTopDocuments(matched_documents);
+    return explanation;
+}
+
+//Статистика своей части корпуса для слов запроса
+QueryStatistics SearchServer::GetQueryStatistics(std::string_view raw_query) const {
+    const QueryArena::Scope arena;
+    const Query query = ParseQuery(raw_query);
+    QueryStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    statistics.total_document_length = total_document_length_;
+    for (const std::string_view word : query.plus_words) {
+        const auto word_freqs = word_to_document_freqs_.find(word);
+        if (word_freqs != word_to_document_freqs_.end() && !word_freqs->second.empty()) {
+            statistics.document_freqs.emplace(word, static_cast<int>(word_freqs->second.size()));
+        }
+    }
+    return statistics;
+}
+
+//Статистика корпуса для моделей ранжирования
+    CorpusStatistics SearchServer::GetCorpusStatistics() const {
+        const int document_count = GetDocumentCount();
+        return { document_count, document_count > 0 ? total_document_length_ / document_count : 0.0 };
     }
\ No newline at end of file
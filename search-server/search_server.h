@@ -1,59 +1,175 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <deque>
+#include <exception>
+#include <future>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <execution>
 #include "string_processing.h"
 #include "document.h"
 #include "concurrent_map.h"
+#include "scoring_models.h"
+#include "query_executor.h"
+#include "thread_pool.h"
+#include "memory_accounting.h"
+#include "stop_words.h"
+#include "levenshtein_automaton.h"
+#include "word_frequencies_view.h"
+#include "query_plan.h"
+#include "query_arena.h"
+#include "mapped_file.h"
 
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const double MIN_DELTA = 1e-6;
 const int LOCK_COUNT = 16;
+// Ограничение для плюс-префиксов; минус-префикс раскрывается полностью, иначе документы с не попавшими в него словами
+// не исключались бы
+const int MAX_PREFIX_EXPANSIONS = 64;
 
+struct QueryBudget {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    size_t max_postings = std::numeric_limits<size_t>::max();
+};
+
+struct FuzzyOptions {
+    int max_edits = 1;
+    // Множитель релевантности за каждую правку: слово на расстоянии d получает вес edit_penalty^d
+    double edit_penalty = 0.5;
+};
+
+struct SearchResult {
+    std::vector<Document> documents;
+    bool truncated = false;
+};
+
+// Статистика корпуса для слов одного запроса. Узлы кластера складывают свои статистики,
+// чтобы IDF и средняя длина документа совпадали с одним сервером на всем корпусе
+struct QueryStatistics {
+    int document_count = 0;
+    double total_document_length = 0.0;
+    // Число документов с плюс-словом запроса; слова без документов не записываются
+    std::map<std::string, int, std::less<>> document_freqs;
+};
 
 class SearchServer {
 public:
+    // memory_resource - вышестоящий ресурс для структур индекса (например, pool_resource или арена на huge pages).
+    // Временные структуры запросов выделяются на арене запроса (query_arena.h)
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words);
+    explicit SearchServer(const StringContainer& stop_words, CaseFolding case_folding = CaseFolding::NONE,
+                          std::pmr::memory_resource* memory_resource = std::pmr::get_default_resource());
+    template <size_t N>
+    explicit SearchServer(const StaticStopWords<N>& stop_words, CaseFolding case_folding = CaseFolding::NONE,
+                          std::pmr::memory_resource* memory_resource = std::pmr::get_default_resource());
     
-    explicit SearchServer(const std::string& stop_words_text);
-    explicit SearchServer(std::string_view stop_words_text);
+    explicit SearchServer(const std::string& stop_words_text, CaseFolding case_folding = CaseFolding::NONE,
+                          std::pmr::memory_resource* memory_resource = std::pmr::get_default_resource());
+    explicit SearchServer(std::string_view stop_words_text, CaseFolding case_folding = CaseFolding::NONE,
+                          std::pmr::memory_resource* memory_resource = std::pmr::get_default_resource());
          
 
 
     void AddDocument(int document_id, std::string_view document, DocumentStatus status,
                      const std::vector<int>& ratings);
+    // Отображение переходит во владение сервера и живет до его разрушения
+    const MappedFile& AdoptMappedFile(MappedFile file);
+    // Как AddDocument, но текст из принятого сервером отображения не копируется: индекс ссылается прямо в него.
+    // При приведении регистра слова пишутся на место, поэтому текст копируется, как в AddDocument
+    void AddMappedDocument(int document_id, std::string_view document, DocumentStatus status,
+                           const std::vector<int>& ratings);
     
-    template <typename DocumentPredicate, typename ExecutionPolicy>
+    template <typename ScoringModel = TfIdfScoring, typename DocumentPredicate, typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
 
 
-    template <typename DocumentPredicate>
+    // Без политики выполнения стратегию выбирает планировщик. Предикат вызывается только из вызывающего потока:
+    // стратегию PARALLEL выбирают лишь перегрузки со статусом, а с предикатом нужно явно передать partitioned_par
+    template <typename ScoringModel = TfIdfScoring, typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const; 
 
-    template <typename ExecutionPolicy>
+    template <typename ScoringModel = TfIdfScoring, typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const;
+    template <typename ScoringModel = TfIdfScoring>
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
     
-    template <typename ExecutionPolicy>
+    template <typename ScoringModel = TfIdfScoring, typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const;
+    template <typename ScoringModel = TfIdfScoring>
     std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    template <typename ScoringModel = TfIdfScoring, typename DocumentPredicate>
+    SearchResult FindTopDocumentsWithBudget(std::string_view raw_query, DocumentPredicate document_predicate, const QueryBudget& budget) const;
+    template <typename ScoringModel = TfIdfScoring>
+    SearchResult FindTopDocumentsWithBudget(std::string_view raw_query, DocumentStatus status, const QueryBudget& budget) const;
+
+    template <typename ScoringModel = TfIdfScoring, typename DocumentPredicate>
+    std::future<SearchResult> FindTopDocumentsAsync(std::string raw_query, DocumentPredicate document_predicate, QueryBudget budget = {}) const;
+    template <typename ScoringModel = TfIdfScoring>
+    std::future<SearchResult> FindTopDocumentsAsync(std::string raw_query, DocumentStatus status = DocumentStatus::ACTUAL, QueryBudget budget = {}) const;
+    // on_complete(std::exception_ptr error, SearchResult result) вызывается в потоке исполнителя запросов.
+    // Исключение из on_complete перехватывается исполнителем и учитывается в GetQueryExecutor().GetFailedTaskCount()
+    template <typename ScoringModel = TfIdfScoring, typename DocumentPredicate, typename Callback>
+    void FindTopDocumentsAsync(std::string raw_query, DocumentPredicate document_predicate, QueryBudget budget, Callback on_complete) const;
+
+    template <typename ScoringModel = TfIdfScoring, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsFuzzy(std::string_view raw_query, DocumentPredicate document_predicate, const FuzzyOptions& options) const;
+    template <typename ScoringModel = TfIdfScoring>
+    std::vector<Document> FindTopDocumentsFuzzy(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL, const FuzzyOptions& options = {}) const;
+
+    // Число документов, которые нашел бы FindTopDocuments без ограничения MAX_RESULT_DOCUMENT_COUNT.
+    // Релевантность не считается: списки документов плюс-слов объединяются, списки минус-слов вычитаются
+    template <typename DocumentPredicate>
+    int CountDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    int CountDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+    // Как CountDocuments, но обход прекращается на первом подходящем документе
+    template <typename DocumentPredicate>
+    bool HasMatches(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    bool HasMatches(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+    // Слова индекса на расстоянии Левенштейна не больше max_edits вместе с расстоянием
+    std::vector<std::pair<std::string_view, int>> ExpandFuzzyWord(std::string_view word, int max_edits) const;
+
+    // План запроса по умолчанию (TF-IDF, статус ACTUAL), найденные документы и число просмотренных записей индекса
+    QueryExplanation Explain(std::string_view raw_query) const;
+
+    QueryStatistics GetQueryStatistics(std::string_view raw_query) const;
+    // Релевантность считается по переданной статистике, а не по своему индексу
+    template <typename ScoringModel = TfIdfScoring, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, const QueryStatistics& statistics) const;
+    template <typename ScoringModel = TfIdfScoring>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, const QueryStatistics& statistics) const;
+
+    void SetQueryExecutorOptions(QueryExecutorOptions options);
+    const QueryExecutor& GetQueryExecutor() const;
+
+    void SetThreadPoolOptions(ThreadPoolOptions options);
+    ThreadPool& GetThreadPool() const;
+    std::vector<WorkerStats> GetThreadPoolStats() const;
     
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    WordFrequenciesView GetWordFrequencies(int document_id) const;
     int GetDocumentCount() const;
 
-    std::set<int>::const_iterator begin() const;
+    std::pmr::set<int>::const_iterator begin() const;
 
-    std::set<int>::const_iterator end() const;
+    std::pmr::set<int>::const_iterator end() const;
+
+    MemoryUsage GetMemoryUsage() const;
+    // max_bytes == 0 снимает ограничение
+    void SetMemoryBudget(size_t max_bytes, MemoryBudgetPolicy policy = MemoryBudgetPolicy::FAIL);
+    void Compact();
     
     void RemoveDocument(int document_id);
     template <typename ExecutionPolicy>
@@ -64,120 +180,450 @@ public:
                                                         int document_id) const;
 ResultMatchDocument MatchDocument( const std::execution::sequenced_policy& policy, std::string_view raw_query, int document_id)  const; 
 ResultMatchDocument MatchDocument( const std::execution::parallel_policy& policy,std::string_view raw_query, int document_id)  const;
+ResultMatchDocument MatchDocument( const PoolExecutionPolicy& policy, std::string_view raw_query, int document_id)  const;
 
+    // Порядок результатов поиска: по релевантности, при равенстве - по рейтингу. Общий для других индексов
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+    // Первые MAX_RESULT_DOCUMENT_COUNT упорядоченных документов в векторе на общей куче: результат переживает арену запроса
+    static std::vector<Document> CopyTopDocuments(const std::pmr::vector<Document>& sorted_documents);
     
 private:
     struct DocumentData {
         int rating;
         DocumentStatus status;
+        int ordinal;
     };
-    const std::set<std::string, std::less<>> stop_words_;
+    const CaseFolding case_folding_;
+    const StopWordSet stop_words_;
+
+    // Каждая структура индекса выделяет память через свой счетчик
+    CountingMemoryResource word_to_document_freqs_memory_;
+    CountingMemoryResource document_to_word_freqs_memory_;
+    CountingMemoryResource document_text_memory_;
+    CountingMemoryResource documents_memory_;
+    CountingMemoryResource document_ids_memory_;
+    CountingMemoryResource document_lengths_memory_;
 
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_; 
+    std::pmr::map<std::string_view, std::pmr::map<int, double>> word_to_document_freqs_{&word_to_document_freqs_memory_}; 
    
-    std::map<int, std::map<std::string_view, double>> document_to_word_freqs_; 
-    std::map<int, std::string> document_text_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
-    bool IsStopWord( std::string_view word) const;
-    static bool IsValidWord( std::string_view word);
-    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
-    static int ComputeAverageRating(const std::vector<int>& ratings);
+    // Прямой индекс по порядковому номеру документа: (id слова, tf), упорядочено по id слова
+    std::pmr::vector<std::pmr::vector<TermFrequency>> document_to_word_freqs_{&document_to_word_freqs_memory_};
+    // Слова по id; это те же string_view, что и ключи word_to_document_freqs_
+    std::pmr::vector<std::string_view> terms_{&document_to_word_freqs_memory_};
+    std::pmr::unordered_map<std::string_view, int> term_ids_{&document_to_word_freqs_memory_};
+    // Наибольший tf слова по id; после удаления документов остается верхней оценкой
+    std::pmr::vector<double> term_max_freqs_{&document_to_word_freqs_memory_};
+    std::pmr::map<int, std::pmr::string> document_text_{&document_text_memory_};
+    // Тексты документов, добавленных без копирования; указывают в mapped_files_
+    std::pmr::map<int, std::string_view> mapped_document_text_{&document_text_memory_};
+    std::deque<MappedFile> mapped_files_;
+    std::pmr::map<int, DocumentData> documents_{&documents_memory_};
+    std::pmr::set<int> document_ids_{&document_ids_memory_};
+    // Длины документов без стоп-слов, индексируются порядковым номером документа
+    std::pmr::vector<double> document_lengths_{&document_lengths_memory_};
+    // id документа по порядковому номеру, -1 для удаленных
+    std::pmr::vector<int> document_ids_by_ordinal_{&document_lengths_memory_};
+    double total_document_length_ = 0.0;
+
+    // Плоские списки документов по id слова для стратегии DENSE: порядковые номера по возрастанию и tf в float.
+    // Записи удаленных документов остаются до Compact и отсекаются по document_ids_by_ordinal_
+    std::pmr::vector<std::pmr::vector<int>> posting_ordinals_{&word_to_document_freqs_memory_};
+    std::pmr::vector<std::pmr::vector<float>> posting_term_freqs_{&word_to_document_freqs_memory_};
 
-    struct QueryWord {
-        std::string_view data;
-        bool is_minus;
-        bool is_stop;
+    // Массив релевантностей по порядковым номерам документов, свой у каждого потока.
+    // После запроса обнуляются только затронутые элементы
+    struct DenseAccumulator {
+        enum : char { UNTOUCHED, CANDIDATE, EXCLUDED };
+        std::vector<float> scores;
+        std::vector<char> states;
+        std::vector<int> touched;
     };
-    QueryWord ParseQueryWord(std::string_view text) const;
+    static DenseAccumulator& GetDenseAccumulator(size_t ordinal_count);
+    static void ResetDenseAccumulator(DenseAccumulator& accumulator);
 
+    size_t memory_budget_ = 0;
+    MemoryBudgetPolicy memory_budget_policy_ = MemoryBudgetPolicy::FAIL;
+    // folded_text - как в ForEachNormalizedWord (stop_words.h)
+    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text, char* folded_text) const;
+    // text должен жить, пока документ в индексе
+    void IndexDocument(int document_id, std::string_view text, char* folded_text, DocumentStatus status,
+                       const std::vector<int>& ratings);
+    std::string_view GetDocumentText(int document_id) const;
+    void CheckMemoryBudget(size_t added_bytes);
+    // Просматривается не больше max_visited слов индекса, включая слова с пустыми после удаления списками
+    void ExpandPrefix(std::string_view prefix, size_t max_visited, std::pmr::vector<std::string_view>& words) const;
+    static int ComputeAverageRating(const std::vector<int>& ratings);
+    // Слово индекса, если оно есть в документе, иначе пустая строка
+    std::string_view FindDocumentWord(const std::pmr::vector<TermFrequency>& term_freqs, std::string_view word) const;
+
+    // Запрос живет на арене запроса, как и остальные временные структуры поиска
     struct Query {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        explicit Query(std::pmr::memory_resource* resource)
+            : plus_words(resource)
+            , minus_words(resource)
+            , folded_text(resource) {
+        }
+
+        std::pmr::vector<std::string_view> plus_words;
+        std::pmr::vector<std::string_view> minus_words;
+        // Слова запроса в нижнем регистре, если сервер приводит регистр
+        std::pmr::vector<char> folded_text;
     };
    Query ParseQuery(std::string_view text) const;
    Query ParseQueryParallel(std::string_view text) const;
+    // Документы запроса по возрастанию id без подсчета релевантности. on_document(document_id) возвращает false,
+    // чтобы прекратить обход
+    template <typename DocumentPredicate, typename Callback>
+    void ForEachMatchedDocument(const Query& query, DocumentPredicate document_predicate, Callback on_document) const;
     
     
 
-    double ComputeWordInverseDocumentFreq(std::string_view word) const;
-template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
-    template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const Query& query, DocumentPredicate document_predicate) const;
-    template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query& query, DocumentPredicate document_predicate) const;
+    // allow_parallel - можно ли выбрать PARALLEL, при котором предикат вызывается из потоков пула
+    QueryPlan BuildQueryPlan(const Query& query, bool allow_parallel) const;
+
+    CorpusStatistics GetCorpusStatistics() const;
+    template <typename ScoringModel, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsPlanned(std::string_view raw_query, DocumentPredicate document_predicate, bool allow_parallel) const;
+template <typename ScoringModel, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    template <typename ScoringModel, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const Query& query, DocumentPredicate document_predicate) const;
+    template <typename ScoringModel, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query& query, DocumentPredicate document_predicate) const;
+    template <typename ScoringModel, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const PoolExecutionPolicy&, const Query& query, DocumentPredicate document_predicate) const;
+    // Выполнение плана; при стратегиях PARALLEL и PRUNED возвращаются не все найденные документы, но все лучшие
+    template <typename ScoringModel, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const Query& query, const QueryPlan& plan, DocumentPredicate document_predicate, size_t& touched_postings) const;
+    // Возвращает объединение лучших документов диапазонов, а не все найденные документы
+    template <typename ScoringModel, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const PartitionedExecutionPolicy&, const Query& query, DocumentPredicate document_predicate) const;
+    // touched_postings - сумма записей, пройденных потоками всех диапазонов
+    template <typename ScoringModel, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const PartitionedExecutionPolicy&, const Query& query, DocumentPredicate document_predicate, size_t& touched_postings) const;
+    // Плотное накопление релевантности в float по плану; лучшие документы пересчитываются точно в double
+    template <typename ScoringModel, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocumentsDense(const QueryPlan& plan, DocumentPredicate document_predicate, size_t& touched_postings) const;
+    template <typename ScoringModel, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate, const QueryBudget& budget, bool& truncated) const;
+    template <typename ScoringModel, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const Query& query, const std::pmr::map<std::string_view, double>& plus_word_weights, DocumentPredicate document_predicate) const;
+    template <typename ScoringModel, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const Query& query, const QueryStatistics& statistics, DocumentPredicate document_predicate) const;
+
+    static constexpr size_t DEADLINE_CHECK_INTERVAL = 256;
+    static constexpr int SEEK_LINEAR_STEPS = 8;
+    // Диапазонов больше, чем потоков, чтобы неравномерно заполненные диапазоны уравновешивались
+    static constexpr size_t PARTITIONS_PER_THREAD = 4;
+    // Пороги планировщика по оценке числа просматриваемых записей индекса
+    static constexpr size_t PRUNED_MIN_POSTINGS = 1024;
+    static constexpr size_t PARALLEL_MIN_POSTINGS = 1 << 16;
+    static constexpr size_t DENSE_MIN_POSTINGS = 4096;
+    // Относительная погрешность накопления в float, с запасом
+    static constexpr float DENSE_SCORE_TOLERANCE = 1e-4f;
+
+    std::unique_ptr<ThreadPool> thread_pool_ = std::make_unique<ThreadPool>();
+    // Объявлен последним: разрушается первым и дожидается задач, которые ещё обращаются к индексу
+    std::unique_ptr<QueryExecutor> query_executor_ = std::make_unique<QueryExecutor>();
  
  };     
 
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
-    : stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+SearchServer::SearchServer(const StringContainer& stop_words, CaseFolding case_folding, std::pmr::memory_resource* memory_resource)
+    : case_folding_(case_folding)
+    , stop_words_(MakeUniqueNonEmptyStrings(stop_words), case_folding)
+    , word_to_document_freqs_memory_(memory_resource)
+    , document_to_word_freqs_memory_(memory_resource)
+    , document_text_memory_(memory_resource)
+    , documents_memory_(memory_resource)
+    , document_ids_memory_(memory_resource)
+    , document_lengths_memory_(memory_resource)
 {
-    if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
-        throw std::invalid_argument("Some of stop words are invalid");
-    }
 }
 
-template <typename DocumentPredicate, typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate) const {
+template <size_t N>
+SearchServer::SearchServer(const StaticStopWords<N>& stop_words, CaseFolding case_folding, std::pmr::memory_resource* memory_resource)
+    : case_folding_(case_folding)
+    , stop_words_(stop_words, case_folding)
+    , word_to_document_freqs_memory_(memory_resource)
+    , document_to_word_freqs_memory_(memory_resource)
+    , document_text_memory_(memory_resource)
+    , documents_memory_(memory_resource)
+    , document_ids_memory_(memory_resource)
+    , document_lengths_memory_(memory_resource)
+{
+}
 
+template <typename ScoringModel, typename DocumentPredicate, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate) const {
+    const QueryArena::Scope arena;
     const auto query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+    auto matched_documents = FindAllDocuments<ScoringModel>(policy, query, document_predicate);
  
-    sort(policy, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-    if (std::abs(lhs.relevance - rhs.relevance) < MIN_DELTA) {
-            return lhs.rating > rhs.rating;
-    }
-    else {
-            return lhs.relevance > rhs.relevance;
+    if constexpr (std::is_execution_policy_v<std::decay_t<ExecutionPolicy>>) {
+        sort(policy, matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+    } else {
+        sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
     }
-        });
-        
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-    return matched_documents;   
+    return CopyTopDocuments(matched_documents);
 }
  
 
-template <typename DocumentPredicate>
+template <typename ScoringModel, typename DocumentPredicate>
     std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
                                       DocumentPredicate document_predicate) const {
-        return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+    return FindTopDocumentsPlanned<ScoringModel>(raw_query, document_predicate, false);
 }
 
-template <typename ExecutionPolicy>
+template <typename ScoringModel, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsPlanned(std::string_view raw_query, DocumentPredicate document_predicate, bool allow_parallel) const {
+    const QueryArena::Scope arena;
+    const auto query = ParseQuery(raw_query);
+    size_t touched_postings = 0;
+    auto matched_documents = FindAllDocuments<ScoringModel>(query, BuildQueryPlan(query, allow_parallel), document_predicate, touched_postings);
+
+    sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+    return CopyTopDocuments(matched_documents);
+}
+
+template <typename ScoringModel, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(policy, raw_query,
+    return FindTopDocuments<ScoringModel>(policy, raw_query,
         [&status](int document_id, DocumentStatus new_status, int rating) {
             return new_status == status;
     });
 }
 
-template <typename ExecutionPolicy>
+//Встроенный предикат потокобезопасен, поэтому планировщику разрешена стратегия PARALLEL
+template <typename ScoringModel>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocumentsPlanned<ScoringModel>(raw_query,
+        [status](int document_id, DocumentStatus new_status, int rating) {
+            return new_status == status;
+    }, true);
+}
+
+template <typename ScoringModel, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const {
-    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+    return FindTopDocuments<ScoringModel>(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename ScoringModel>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments<ScoringModel>(raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename ScoringModel, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, const QueryStatistics& statistics) const {
+    const QueryArena::Scope arena;
+    const auto query = ParseQuery(raw_query);
+    auto matched_documents = FindAllDocuments<ScoringModel>(query, statistics, document_predicate);
+
+    sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+    return CopyTopDocuments(matched_documents);
+}
+
+template <typename ScoringModel>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, const QueryStatistics& statistics) const {
+    return FindTopDocuments<ScoringModel>(raw_query,
+        [status](int document_id, DocumentStatus new_status, int rating) {
+            return new_status == status;
+    }, statistics);
+}
+
+template <typename ScoringModel, typename DocumentPredicate>
+SearchResult SearchServer::FindTopDocumentsWithBudget(std::string_view raw_query, DocumentPredicate document_predicate, const QueryBudget& budget) const {
+    const QueryArena::Scope arena;
+    const auto query = ParseQuery(raw_query);
+    SearchResult result;
+    auto matched_documents = FindAllDocuments<ScoringModel>(query, document_predicate, budget, result.truncated);
+
+    sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+    result.documents = CopyTopDocuments(matched_documents);
+    return result;
+}
+
+template <typename ScoringModel>
+SearchResult SearchServer::FindTopDocumentsWithBudget(std::string_view raw_query, DocumentStatus status, const QueryBudget& budget) const {
+    return FindTopDocumentsWithBudget<ScoringModel>(raw_query,
+        [status](int document_id, DocumentStatus new_status, int rating) {
+            return new_status == status;
+    }, budget);
+}
+
+template <typename ScoringModel, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsFuzzy(std::string_view raw_query, DocumentPredicate document_predicate, const FuzzyOptions& options) const {
+    using namespace std::literals;
+    if (options.max_edits < 0 || options.max_edits > 2) {
+        throw std::invalid_argument("max_edits must be between 0 and 2"s);
+    }
+    const QueryArena::Scope arena;
+    const auto query = ParseQuery(raw_query);
+
+    // Слово индекса может найтись по нескольким словам запроса - берется наибольший вес
+    std::pmr::map<std::string_view, double> plus_word_weights(QueryArena::GetResource());
+    for (const std::string_view word : query.plus_words) {
+        for (const auto& [expanded_word, distance] : ExpandFuzzyWord(word, options.max_edits)) {
+            double& weight = plus_word_weights[expanded_word];
+            weight = std::max(weight, std::pow(options.edit_penalty, distance));
+        }
+    }
+
+    auto matched_documents = FindAllDocuments<ScoringModel>(query, plus_word_weights, document_predicate);
+    sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+    return CopyTopDocuments(matched_documents);
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    return SearchServer::FindAllDocuments(std::execution::seq, query, document_predicate);
+int SearchServer::CountDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    const QueryArena::Scope arena;
+    const auto query = ParseQuery(raw_query);
+    int document_count = 0;
+    ForEachMatchedDocument(query, document_predicate, [&document_count](int document_id) {
+        ++document_count;
+        return true;
+    });
+    return document_count;
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy&, const Query& query, DocumentPredicate document_predicate) const {
+bool SearchServer::HasMatches(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    const QueryArena::Scope arena;
+    const auto query = ParseQuery(raw_query);
+    bool has_matches = false;
+    ForEachMatchedDocument(query, document_predicate, [&has_matches](int document_id) {
+        has_matches = true;
+        return false;
+    });
+    return has_matches;
+}
+
+template <typename DocumentPredicate, typename Callback>
+void SearchServer::ForEachMatchedDocument(const Query& query, DocumentPredicate document_predicate, Callback on_document) const {
+    // Текущая и конечная записи списка документов слова; списки упорядочены по id документа
+    using PostingCursor = std::pair<std::pmr::map<int, double>::const_iterator, std::pmr::map<int, double>::const_iterator>;
+    const auto add_cursors = [this](const std::pmr::vector<std::string_view>& words, std::pmr::vector<PostingCursor>& cursors) {
+        for (const std::string_view word : words) {
+            const auto word_freqs = word_to_document_freqs_.find(word);
+            if (word_freqs != word_to_document_freqs_.end() && !word_freqs->second.empty()) {
+                cursors.emplace_back(word_freqs->second.begin(), word_freqs->second.end());
+            }
+        }
+    };
+    std::pmr::vector<PostingCursor> plus_cursors(QueryArena::GetResource());
+    std::pmr::vector<PostingCursor> minus_cursors(QueryArena::GetResource());
+    add_cursors(query.plus_words, plus_cursors);
+    add_cursors(query.minus_words, minus_cursors);
+
+    // Слияние k списков: куча по id текущей записи, наверху список с наименьшим id
+    const auto is_after = [](const PostingCursor& lhs, const PostingCursor& rhs) {
+        return lhs.first->first > rhs.first->first;
+    };
+    std::make_heap(plus_cursors.begin(), plus_cursors.end(), is_after);
+    while (!plus_cursors.empty()) {
+        const int document_id = plus_cursors.front().first->first;
+        // Сдвигаются все списки с этим документом, поэтому он попадает в объединение один раз
+        while (!plus_cursors.empty() && plus_cursors.front().first->first == document_id) {
+            std::pop_heap(plus_cursors.begin(), plus_cursors.end(), is_after);
+            PostingCursor& cursor = plus_cursors.back();
+            if (++cursor.first == cursor.second) {
+                plus_cursors.pop_back();
+            } else {
+                std::push_heap(plus_cursors.begin(), plus_cursors.end(), is_after);
+            }
+        }
+
+        // id документов возрастают, поэтому списки минус-слов проходятся один раз
+        const bool has_minus_word = std::any_of(minus_cursors.begin(), minus_cursors.end(), [document_id](PostingCursor& cursor) {
+            while (cursor.first != cursor.second && cursor.first->first < document_id) {
+                ++cursor.first;
+            }
+            return cursor.first != cursor.second && cursor.first->first == document_id;
+        });
+        if (has_minus_word) {
+            continue;
+        }
+        const auto& document_data = documents_.at(document_id);
+        if (document_predicate(document_id, document_data.status, document_data.rating) && !on_document(document_id)) {
+            return;
+        }
+    }
+}
+
+template <typename ScoringModel>
+std::vector<Document> SearchServer::FindTopDocumentsFuzzy(std::string_view raw_query, DocumentStatus status, const FuzzyOptions& options) const {
+    return FindTopDocumentsFuzzy<ScoringModel>(raw_query,
+        [status](int document_id, DocumentStatus new_status, int rating) {
+            return new_status == status;
+    }, options);
+}
+
+template <typename ScoringModel, typename DocumentPredicate>
+std::future<SearchResult> SearchServer::FindTopDocumentsAsync(std::string raw_query, DocumentPredicate document_predicate, QueryBudget budget) const {
+    auto promise = std::make_shared<std::promise<SearchResult>>();
+    std::future<SearchResult> result = promise->get_future();
+
+    const bool accepted = query_executor_->TrySubmit(
+        [this, promise, raw_query = std::move(raw_query), document_predicate, budget] {
+            try {
+                promise->set_value(FindTopDocumentsWithBudget<ScoringModel>(raw_query, document_predicate, budget));
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+    });
+    if (!accepted) {
+        throw std::runtime_error("Query executor is saturated");
+    }
+    return result;
+}
 
-std::map<int, double> document_to_relevance;
+template <typename ScoringModel>
+std::future<SearchResult> SearchServer::FindTopDocumentsAsync(std::string raw_query, DocumentStatus status, QueryBudget budget) const {
+    return FindTopDocumentsAsync<ScoringModel>(std::move(raw_query),
+        [status](int document_id, DocumentStatus new_status, int rating) {
+            return new_status == status;
+    }, budget);
+}
+
+template <typename ScoringModel, typename DocumentPredicate, typename Callback>
+void SearchServer::FindTopDocumentsAsync(std::string raw_query, DocumentPredicate document_predicate, QueryBudget budget, Callback on_complete) const {
+    const bool accepted = query_executor_->TrySubmit(
+        [this, raw_query = std::move(raw_query), document_predicate, budget, on_complete]() mutable {
+            SearchResult result;
+            std::exception_ptr error;
+            try {
+                result = FindTopDocumentsWithBudget<ScoringModel>(raw_query, document_predicate, budget);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            on_complete(error, std::move(result));
+    });
+    if (!accepted) {
+        throw std::runtime_error("Query executor is saturated");
+    }
+}
+
+template <typename ScoringModel, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
+    return SearchServer::FindAllDocuments<ScoringModel>(std::execution::seq, query, document_predicate);
+}
+
+template <typename ScoringModel, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy&, const Query& query, DocumentPredicate document_predicate) const {
+
+std::pmr::map<int, double> document_to_relevance(QueryArena::GetResource());
+    const ScoringModel scoring_model(GetCorpusStatistics());
 
     for_each (query.plus_words.begin(), query.plus_words.end(), 
-    [this, &document_predicate, &document_to_relevance] (const std::string_view& word) {
-        if (word_to_document_freqs_.count(std::string(word)) != 0) {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(std::string(word))) {
+    [this, &scoring_model, &document_predicate, &document_to_relevance] (const std::string_view& word) {
+        const auto word_freqs = word_to_document_freqs_.find(word);
+        if (word_freqs != word_to_document_freqs_.end()) {
+            const double inverse_document_freq = scoring_model.ComputeInverseDocumentFreq(static_cast<int>(word_freqs->second.size()));
+            for (const auto [document_id, term_freq] : word_freqs->second) {
                 const auto& document_data = documents_.at(document_id);
                 if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id] += term_freq * inverse_document_freq;
+                    document_to_relevance[document_id] += scoring_model.ComputeTermScore(
+                        term_freq, inverse_document_freq, document_lengths_[document_data.ordinal]);
                 }
             }
         }
@@ -192,7 +638,7 @@ std::map<int, double> document_to_relevance;
         }
     });
     
-    std::vector<Document> matched_documents;
+    std::pmr::vector<Document> matched_documents(QueryArena::GetResource());
     for (const auto [document_id, relevance] : document_to_relevance) {
         matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
     }
@@ -202,20 +648,62 @@ std::map<int, double> document_to_relevance;
 
 
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy&, const Query& query, DocumentPredicate document_predicate) const {
+template <typename ScoringModel, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const Query& query, const QueryStatistics& statistics, DocumentPredicate document_predicate) const {
+    const double average_document_length = statistics.document_count > 0
+        ? statistics.total_document_length / statistics.document_count : 0.0;
+    const ScoringModel scoring_model(CorpusStatistics{ statistics.document_count, average_document_length });
+
+    std::pmr::map<int, double> document_to_relevance(QueryArena::GetResource());
+    for (const std::string_view word : query.plus_words) {
+        const auto word_freqs = word_to_document_freqs_.find(word);
+        const auto document_freq = statistics.document_freqs.find(word);
+        if (word_freqs == word_to_document_freqs_.end() || document_freq == statistics.document_freqs.end()) {
+            continue;
+        }
+        const double inverse_document_freq = scoring_model.ComputeInverseDocumentFreq(document_freq->second);
+        for (const auto [document_id, term_freq] : word_freqs->second) {
+            const auto& document_data = documents_.at(document_id);
+            if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                document_to_relevance[document_id] += scoring_model.ComputeTermScore(
+                    term_freq, inverse_document_freq, document_lengths_[document_data.ordinal]);
+            }
+        }
+    }
+
+    for (const std::string_view word : query.minus_words) {
+        const auto word_freqs = word_to_document_freqs_.find(word);
+        if (word_freqs != word_to_document_freqs_.end()) {
+            for (const auto [document_id, _] : word_freqs->second) {
+                document_to_relevance.erase(document_id);
+            }
+        }
+    }
+
+    std::pmr::vector<Document> matched_documents(QueryArena::GetResource());
+    for (const auto [document_id, relevance] : document_to_relevance) {
+        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+    }
+    return matched_documents;
+}
+
+template <typename ScoringModel, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy&, const Query& query, DocumentPredicate document_predicate) const {
     
     ConcurrentMap<int, double> document_to_relevance(LOCK_COUNT);
+    const ScoringModel scoring_model(GetCorpusStatistics());
 
     std::for_each(std::execution::par,
         query.plus_words.begin(), query.plus_words.end(),
-        [this, &document_predicate, &document_to_relevance](std::string_view word) {
-            if (word_to_document_freqs_.count(word)) {
-                const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-                for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
+        [this, &scoring_model, &document_predicate, &document_to_relevance](std::string_view word) {
+            const auto word_freqs = word_to_document_freqs_.find(word);
+            if (word_freqs != word_to_document_freqs_.end()) {
+                const double inverse_document_freq = scoring_model.ComputeInverseDocumentFreq(static_cast<int>(word_freqs->second.size()));
+                for (const auto [document_id, term_freq] : word_freqs->second) {
                     const auto& document_data = documents_.at(document_id);
                     if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                        document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
+                        document_to_relevance[document_id].ref_to_value += scoring_model.ComputeTermScore(
+                            term_freq, inverse_document_freq, document_lengths_[document_data.ordinal]);
                     }
                 }
             }
@@ -230,8 +718,8 @@ std::vector<Document> SearchServer::FindAllDocuments(const std::execution::paral
         }
     });
 
-    std::map<int, double> document_to_relevance_reduced = document_to_relevance.BuildOrdinaryMap();
-    std::vector<Document> matched_documents;
+    const auto document_to_relevance_reduced = document_to_relevance.BuildOrdinaryMap(QueryArena::GetResource());
+    std::pmr::vector<Document> matched_documents(QueryArena::GetResource());
     matched_documents.reserve(document_to_relevance_reduced.size());
 
     for (const auto [document_id, relevance] : document_to_relevance_reduced) {
@@ -240,28 +728,493 @@ std::vector<Document> SearchServer::FindAllDocuments(const std::execution::paral
     return matched_documents;
 
 }
+
+template <typename ScoringModel, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const PoolExecutionPolicy&, const Query& query, DocumentPredicate document_predicate) const {
+
+    ConcurrentMap<int, double> document_to_relevance(LOCK_COUNT);
+    const ScoringModel scoring_model(GetCorpusStatistics());
+
+    thread_pool_->ParallelFor(query.plus_words.size(),
+        [this, &query, &scoring_model, &document_predicate, &document_to_relevance](size_t index) {
+            const auto word_freqs = word_to_document_freqs_.find(query.plus_words[index]);
+            if (word_freqs != word_to_document_freqs_.end()) {
+                const double inverse_document_freq = scoring_model.ComputeInverseDocumentFreq(static_cast<int>(word_freqs->second.size()));
+                for (const auto [document_id, term_freq] : word_freqs->second) {
+                    const auto& document_data = documents_.at(document_id);
+                    if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                        document_to_relevance[document_id].ref_to_value += scoring_model.ComputeTermScore(
+                            term_freq, inverse_document_freq, document_lengths_[document_data.ordinal]);
+                    }
+                }
+            }
+    });
+
+    thread_pool_->ParallelFor(query.minus_words.size(),
+        [this, &query, &document_to_relevance](size_t index) {
+            const auto word_freqs = word_to_document_freqs_.find(query.minus_words[index]);
+            if (word_freqs != word_to_document_freqs_.end()) {
+                for (const auto [document_id, _] : word_freqs->second) {
+                    document_to_relevance.Erase(document_id);
+                }
+            }
+    });
+
+    const auto document_to_relevance_reduced = document_to_relevance.BuildOrdinaryMap(QueryArena::GetResource());
+    std::pmr::vector<Document> matched_documents(QueryArena::GetResource());
+    matched_documents.reserve(document_to_relevance_reduced.size());
+
+    for (const auto [document_id, relevance] : document_to_relevance_reduced) {
+        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+    }
+    return matched_documents;
+}
+
+template <typename ScoringModel, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const Query& query, const QueryPlan& plan, DocumentPredicate document_predicate, size_t& touched_postings) const {
+    if (plan.strategy == QueryStrategy::PARALLEL) {
+        return FindAllDocuments<ScoringModel>(partitioned_par, query, document_predicate, touched_postings);
+    }
+    if (plan.strategy == QueryStrategy::DENSE) {
+        return FindAllDocumentsDense<ScoringModel>(plan, document_predicate, touched_postings);
+    }
+
+    const ScoringModel scoring_model(GetCorpusStatistics());
+    std::pmr::vector<const std::pmr::map<int, double>*> minus_word_freqs(QueryArena::GetResource());
+    for (const PlannedTerm& term : plan.minus_terms) {
+        minus_word_freqs.push_back(&word_to_document_freqs_.at(term.word));
+    }
+    std::pmr::vector<const std::pmr::map<int, double>*> plus_word_freqs(QueryArena::GetResource());
+    std::pmr::vector<double> inverse_document_freqs(QueryArena::GetResource());
+    // remaining_upper_bounds[i] - наибольшая релевантность, которую документ может набрать на словах i, i + 1, ...
+    std::pmr::vector<double> remaining_upper_bounds(plan.plus_terms.size() + 1, 0.0, QueryArena::GetResource());
+    for (const PlannedTerm& term : plan.plus_terms) {
+        plus_word_freqs.push_back(&word_to_document_freqs_.at(term.word));
+        inverse_document_freqs.push_back(scoring_model.ComputeInverseDocumentFreq(static_cast<int>(term.posting_count)));
+    }
+    for (size_t i = plan.plus_terms.size(); i-- > 0;) {
+        remaining_upper_bounds[i] = remaining_upper_bounds[i + 1] + scoring_model.ComputeTermScoreUpperBound(
+            term_max_freqs_[term_ids_.at(plan.plus_terms[i].word)], inverse_document_freqs[i]);
+    }
+
+    std::pmr::map<int, double> document_to_relevance(QueryArena::GetResource());
+    std::pmr::set<int> rejected_documents(QueryArena::GetResource());
+    // Минус-слова и предикат проверяются один раз для документа, до подсчета его релевантности
+    const auto is_accepted = [this, &minus_word_freqs, &document_predicate, &touched_postings](int document_id) {
+        for (const auto* word_freqs : minus_word_freqs) {
+            ++touched_postings;
+            if (word_freqs->count(document_id) > 0) {
+                return false;
+            }
+        }
+        const auto& document_data = documents_.at(document_id);
+        return document_predicate(document_id, document_data.status, document_data.rating);
+    };
+    // Релевантность неотрицательна и только растет, поэтому K-я по величине - нижняя граница K-й итоговой
+    const auto get_top_threshold = [&document_to_relevance] {
+        std::pmr::vector<double> relevances(QueryArena::GetResource());
+        relevances.reserve(document_to_relevance.size());
+        for (const auto [document_id, relevance] : document_to_relevance) {
+            relevances.push_back(relevance);
+        }
+        std::nth_element(relevances.begin(), relevances.begin() + (MAX_RESULT_DOCUMENT_COUNT - 1), relevances.end(), std::greater<>());
+        return relevances[MAX_RESULT_DOCUMENT_COUNT - 1];
+    };
+
+    for (size_t i = 0; i < plus_word_freqs.size(); ++i) {
+        const auto& word_freqs = *plus_word_freqs[i];
+        const double inverse_document_freq = inverse_document_freqs[i];
+        const auto add_score = [this, &scoring_model, inverse_document_freq](int document_id, double term_freq, double& relevance) {
+            relevance += scoring_model.ComputeTermScore(term_freq, inverse_document_freq,
+                document_lengths_[documents_.at(document_id).ordinal]);
+        };
+
+        const bool is_continue_mode = plan.strategy == QueryStrategy::PRUNED
+            && document_to_relevance.size() >= static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)
+            && remaining_upper_bounds[i] < get_top_threshold() - MIN_DELTA;
+        if (!is_continue_mode) {
+            for (const auto [document_id, term_freq] : word_freqs) {
+                ++touched_postings;
+                auto it = document_to_relevance.find(document_id);
+                if (it == document_to_relevance.end()) {
+                    if (rejected_documents.count(document_id) > 0) {
+                        continue;
+                    }
+                    if (!is_accepted(document_id)) {
+                        rejected_documents.insert(document_id);
+                        continue;
+                    }
+                    it = document_to_relevance.emplace(document_id, 0.0).first;
+                }
+                add_score(document_id, term_freq, it->second);
+            }
+        } else if (word_freqs.size() <= document_to_relevance.size()) {
+            // Новые документы уже не попадут в лучшие: слово только уточняет релевантность найденных
+            for (const auto [document_id, term_freq] : word_freqs) {
+                ++touched_postings;
+                const auto it = document_to_relevance.find(document_id);
+                if (it != document_to_relevance.end()) {
+                    add_score(document_id, term_freq, it->second);
+                }
+            }
+        } else {
+            for (auto& [document_id, relevance] : document_to_relevance) {
+                ++touched_postings;
+                const auto it = word_freqs.find(document_id);
+                if (it != word_freqs.end()) {
+                    add_score(document_id, it->second, relevance);
+                }
+            }
+        }
+    }
+
+    std::pmr::vector<Document> matched_documents(QueryArena::GetResource());
+    matched_documents.reserve(document_to_relevance.size());
+    for (const auto [document_id, relevance] : document_to_relevance) {
+        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+    }
+    return matched_documents;
+}
+
+template <typename ScoringModel, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocumentsDense(const QueryPlan& plan, DocumentPredicate document_predicate, size_t& touched_postings) const {
+    const ScoringModel scoring_model(GetCorpusStatistics());
+    DenseAccumulator& accumulator = GetDenseAccumulator(document_ids_by_ordinal_.size());
+    struct ResetGuard {
+        DenseAccumulator& accumulator;
+        ~ResetGuard() {
+            ResetDenseAccumulator(accumulator);
+        }
+    } reset_guard{accumulator};
+    float* scores = accumulator.scores.data();
+    char* states = accumulator.states.data();
+
+    for (const PlannedTerm& term : plan.minus_terms) {
+        const auto& ordinals = posting_ordinals_[term_ids_.at(term.word)];
+        touched_postings += ordinals.size();
+        for (const int ordinal : ordinals) {
+            if (states[ordinal] == DenseAccumulator::UNTOUCHED) {
+                accumulator.touched.push_back(ordinal);
+            }
+            states[ordinal] = DenseAccumulator::EXCLUDED;
+        }
+    }
+
+    struct ScoredTerm {
+        int term_id;
+        double inverse_document_freq;
+    };
+    std::pmr::vector<ScoredTerm> scored_terms(QueryArena::GetResource());
+    scored_terms.reserve(plan.plus_terms.size());
+    for (const PlannedTerm& term : plan.plus_terms) {
+        const int term_id = term_ids_.at(term.word);
+        const double inverse_document_freq = scoring_model.ComputeInverseDocumentFreq(static_cast<int>(term.posting_count));
+        scored_terms.push_back({ term_id, inverse_document_freq });
+        const auto& ordinals = posting_ordinals_[term_id];
+        touched_postings += ordinals.size();
+        scoring_model.AccumulateScores(ordinals.data(), posting_term_freqs_[term_id].data(), ordinals.size(),
+                                       inverse_document_freq, document_lengths_.data(), scores);
+        for (const int ordinal : ordinals) {
+            if (states[ordinal] == DenseAccumulator::UNTOUCHED) {
+                states[ordinal] = DenseAccumulator::CANDIDATE;
+                accumulator.touched.push_back(ordinal);
+            }
+        }
+    }
+
+    std::pmr::vector<std::pair<float, int>> candidates(QueryArena::GetResource());
+    for (const int ordinal : accumulator.touched) {
+        if (states[ordinal] == DenseAccumulator::CANDIDATE && document_ids_by_ordinal_[ordinal] >= 0) {
+            candidates.emplace_back(scores[ordinal], ordinal);
+        }
+    }
+    sort(candidates.begin(), candidates.end(), std::greater<>());
+
+    // Предикат проверяется в порядке убывания приближенной релевантности. После K-го принятого документа
+    // берутся еще те, что могут сравняться с ним после точного пересчета
+    std::pmr::vector<Document> matched_documents(QueryArena::GetResource());
+    float min_score = -std::numeric_limits<float>::infinity();
+    for (const auto& [score, ordinal] : candidates) {
+        if (score < min_score) {
+            break;
+        }
+        const int document_id = document_ids_by_ordinal_[ordinal];
+        const auto& document_data = documents_.at(document_id);
+        if (!document_predicate(document_id, document_data.status, document_data.rating)) {
+            continue;
+        }
+
+        const auto& term_freqs = document_to_word_freqs_[ordinal];
+        double relevance = 0.0;
+        for (const ScoredTerm& term : scored_terms) {
+            const auto it = std::lower_bound(term_freqs.begin(), term_freqs.end(), term.term_id,
+                [](const TermFrequency& item, int term_id) { return item.term_id < term_id; });
+            if (it != term_freqs.end() && it->term_id == term.term_id) {
+                relevance += scoring_model.ComputeTermScore(it->term_freq, term.inverse_document_freq, document_lengths_[ordinal]);
+            }
+        }
+        matched_documents.push_back({ document_id, relevance, document_data.rating });
+        if (matched_documents.size() == static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)) {
+            min_score = score - (std::abs(score) * DENSE_SCORE_TOLERANCE + static_cast<float>(MIN_DELTA));
+        }
+    }
+    return matched_documents;
+}
+
+template <typename ScoringModel, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const PartitionedExecutionPolicy& policy, const Query& query, DocumentPredicate document_predicate) const {
+    size_t touched_postings = 0;
+    return FindAllDocuments<ScoringModel>(policy, query, document_predicate, touched_postings);
+}
+
+template <typename ScoringModel, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const PartitionedExecutionPolicy&, const Query& query, DocumentPredicate document_predicate, size_t& touched_postings) const {
+    if (document_ids_.empty()) {
+        return {};
+    }
+    const ScoringModel scoring_model(GetCorpusStatistics());
+
+    struct TermCursor {
+        const std::pmr::map<int, double>* word_freqs;
+        double inverse_document_freq;
+    };
+    std::pmr::vector<TermCursor> plus_terms(QueryArena::GetResource());
+    for (const std::string_view word : query.plus_words) {
+        const auto word_freqs = word_to_document_freqs_.find(word);
+        if (word_freqs != word_to_document_freqs_.end() && !word_freqs->second.empty()) {
+            plus_terms.push_back({&word_freqs->second,
+                scoring_model.ComputeInverseDocumentFreq(static_cast<int>(word_freqs->second.size()))});
+        }
+    }
+    std::pmr::vector<const std::pmr::map<int, double>*> minus_terms(QueryArena::GetResource());
+    for (const std::string_view word : query.minus_words) {
+        const auto word_freqs = word_to_document_freqs_.find(word);
+        if (word_freqs != word_to_document_freqs_.end() && !word_freqs->second.empty()) {
+            minus_terms.push_back(&word_freqs->second);
+        }
+    }
+    if (plus_terms.empty()) {
+        return {};
+    }
+
+    const long long min_id = *document_ids_.begin();
+    const long long id_span = static_cast<long long>(*document_ids_.rbegin()) - min_id + 1;
+    const size_t partition_count = static_cast<size_t>(std::min<long long>(id_span,
+        static_cast<long long>(std::max<size_t>(thread_pool_->GetThreadCount(), 1) * PARTITIONS_PER_THREAD)));
+    std::pmr::vector<std::vector<Document>> partition_results(partition_count, QueryArena::GetResource());
+    // Счетчик записывается потоком диапазона один раз в конце, суммируется после ParallelFor
+    std::pmr::vector<size_t> partition_postings(partition_count, 0, QueryArena::GetResource());
+
+    thread_pool_->ParallelFor(partition_count, [&](size_t partition) {
+        // Границы в long long: конец последнего диапазона на единицу больше наибольшего id и не помещается в int при id INT_MAX
+        const long long range_begin = min_id + id_span * static_cast<long long>(partition) / static_cast<long long>(partition_count);
+        const long long range_end = min_id + id_span * static_cast<long long>(partition + 1) / static_cast<long long>(partition_count);
+        const bool is_last_partition = partition + 1 == partition_count;
+
+        // Слияние записей слов по возрастанию id: документ оценивается целиком, один раз
+        using Iterator = std::pmr::map<int, double>::const_iterator;
+        const auto get_range = [&](const std::pmr::map<int, double>& word_freqs) {
+            return std::pair<Iterator, Iterator>{ word_freqs.lower_bound(static_cast<int>(range_begin)),
+                is_last_partition ? word_freqs.end() : word_freqs.lower_bound(static_cast<int>(range_end)) };
+        };
+        std::vector<std::pair<Iterator, Iterator>> plus_cursors;
+        for (const TermCursor& term : plus_terms) {
+            plus_cursors.push_back(get_range(*term.word_freqs));
+        }
+        std::vector<std::pair<Iterator, Iterator>> minus_cursors;
+        for (const auto* word_freqs : minus_terms) {
+            minus_cursors.push_back(get_range(*word_freqs));
+        }
+
+        std::vector<Document>& top_documents = partition_results[partition];
+        size_t partition_touched_postings = 0;
+        while (true) {
+            bool has_document = false;
+            int document_id = 0;
+            for (const auto& [it, end] : plus_cursors) {
+                if (it != end && (!has_document || it->first < document_id)) {
+                    document_id = it->first;
+                    has_document = true;
+                }
+            }
+            if (!has_document) {
+                break;
+            }
+
+            bool is_excluded = false;
+            for (auto& [it, end] : minus_cursors) {
+                while (it != end && it->first < document_id) {
+                    ++it;
+                    ++partition_touched_postings;
+                }
+                is_excluded = is_excluded || (it != end && it->first == document_id);
+            }
+            const auto& document_data = documents_.at(document_id);
+            const bool is_matched = !is_excluded && document_predicate(document_id, document_data.status, document_data.rating);
+            double relevance = 0.0;
+            for (size_t i = 0; i < plus_cursors.size(); ++i) {
+                auto& [it, end] = plus_cursors[i];
+                if (it != end && it->first == document_id) {
+                    if (is_matched) {
+                        relevance += scoring_model.ComputeTermScore(it->second, plus_terms[i].inverse_document_freq,
+                            document_lengths_[document_data.ordinal]);
+                    }
+                    ++it;
+                    ++partition_touched_postings;
+                }
+            }
+            if (!is_matched) {
+                continue;
+            }
+
+            top_documents.push_back({ document_id, relevance, document_data.rating });
+            if (top_documents.size() == 2 * MAX_RESULT_DOCUMENT_COUNT) {
+                std::partial_sort(top_documents.begin(), top_documents.begin() + MAX_RESULT_DOCUMENT_COUNT, top_documents.end(), IsMoreRelevant);
+                top_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+            }
+        }
+        partition_postings[partition] = partition_touched_postings;
+    });
+
+    for (const size_t postings : partition_postings) {
+        touched_postings += postings;
+    }
+    std::pmr::vector<Document> matched_documents(QueryArena::GetResource());
+    for (const auto& top_documents : partition_results) {
+        matched_documents.insert(matched_documents.end(), top_documents.begin(), top_documents.end());
+    }
+    return matched_documents;
+}
+
+template <typename ScoringModel, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const Query& query, const std::pmr::map<std::string_view, double>& plus_word_weights, DocumentPredicate document_predicate) const {
+
+    std::pmr::map<int, double> document_to_relevance(QueryArena::GetResource());
+    const ScoringModel scoring_model(GetCorpusStatistics());
+
+    for (const auto [word, weight] : plus_word_weights) {
+        const auto& word_freqs = word_to_document_freqs_.at(word);
+        const double inverse_document_freq = scoring_model.ComputeInverseDocumentFreq(static_cast<int>(word_freqs.size()));
+        for (const auto [document_id, term_freq] : word_freqs) {
+            const auto& document_data = documents_.at(document_id);
+            if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                document_to_relevance[document_id] += weight * scoring_model.ComputeTermScore(
+                    term_freq, inverse_document_freq, document_lengths_[document_data.ordinal]);
+            }
+        }
+    }
+
+    for (const std::string_view word : query.minus_words) {
+        const auto word_freqs = word_to_document_freqs_.find(word);
+        if (word_freqs != word_to_document_freqs_.end()) {
+            for (const auto [document_id, _] : word_freqs->second) {
+                document_to_relevance.erase(document_id);
+            }
+        }
+    }
+
+    std::pmr::vector<Document> matched_documents(QueryArena::GetResource());
+    for (const auto [document_id, relevance] : document_to_relevance) {
+        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+    }
+    return matched_documents;
+}
+
+template <typename ScoringModel, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate, const QueryBudget& budget, bool& truncated) const {
+
+    std::pmr::map<int, double> document_to_relevance(QueryArena::GetResource());
+    const ScoringModel scoring_model(GetCorpusStatistics());
+
+    // Редкие слова обрабатываются первыми: у них наибольший IDF, поэтому частичный результат ближе к полному
+    std::pmr::vector<const std::pmr::map<int, double>*> plus_word_freqs(QueryArena::GetResource());
+    for (const std::string_view word : query.plus_words) {
+        const auto word_freqs = word_to_document_freqs_.find(word);
+        if (word_freqs != word_to_document_freqs_.end() && !word_freqs->second.empty()) {
+            plus_word_freqs.push_back(&word_freqs->second);
+        }
+    }
+    sort(plus_word_freqs.begin(), plus_word_freqs.end(), [](const auto* lhs, const auto* rhs) {
+        return lhs->size() < rhs->size();
+    });
+
+    size_t processed_postings = 0;
+    truncated = std::chrono::steady_clock::now() >= budget.deadline;
+    for (const auto* word_freqs : plus_word_freqs) {
+        if (truncated) {
+            break;
+        }
+        const double inverse_document_freq = scoring_model.ComputeInverseDocumentFreq(static_cast<int>(word_freqs->size()));
+        for (const auto [document_id, term_freq] : *word_freqs) {
+            if (processed_postings == budget.max_postings
+                || (processed_postings % DEADLINE_CHECK_INTERVAL == 0 && processed_postings > 0
+                    && std::chrono::steady_clock::now() >= budget.deadline)) {
+                truncated = true;
+                break;
+            }
+            ++processed_postings;
+            const auto& document_data = documents_.at(document_id);
+            if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                document_to_relevance[document_id] += scoring_model.ComputeTermScore(
+                    term_freq, inverse_document_freq, document_lengths_[document_data.ordinal]);
+            }
+        }
+    }
+
+    // Минус-слова проверяются только для найденных документов, чтобы их стоимость не превышала уже сделанную работу
+    std::pmr::vector<const std::pmr::map<int, double>*> minus_word_freqs(QueryArena::GetResource());
+    for (const std::string_view word : query.minus_words) {
+        const auto word_freqs = word_to_document_freqs_.find(word);
+        if (word_freqs != word_to_document_freqs_.end()) {
+            minus_word_freqs.push_back(&word_freqs->second);
+        }
+    }
+
+    std::pmr::vector<Document> matched_documents(QueryArena::GetResource());
+    for (const auto [document_id, relevance] : document_to_relevance) {
+        const bool is_excluded = any_of(minus_word_freqs.begin(), minus_word_freqs.end(), [document_id = document_id](const auto* word_freqs) {
+            return word_freqs->count(document_id) > 0;
+        });
+        if (!is_excluded) {
+            matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+        }
+    }
+    return matched_documents;
+}
    
 
 template <typename ExecutionPolicy>
 void SearchServer::RemoveDocument(ExecutionPolicy&& policy, int document_id) {
 
-    if (document_to_word_freqs_.count(document_id)) {
-        const std::map<std::string_view, double>& word_freqs = document_to_word_freqs_.at(document_id);
-        std::vector<std::string*> words(word_freqs.size());
+    if (document_ids_.count(document_id)) {
+        const auto& term_freqs = document_to_word_freqs_[documents_.at(document_id).ordinal];
+        std::vector<std::string_view> words(term_freqs.size());
 
+        if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, PoolExecutionPolicy>) {
+            std::transform(term_freqs.begin(), term_freqs.end(), words.begin(),
+                [this](const TermFrequency& item) { return terms_[item.term_id]; });
+            thread_pool_->ParallelFor(words.size(), [this, &words, document_id](size_t index) {
+                word_to_document_freqs_.at(words[index]).erase(document_id);
+            });
+        } else {
         std::transform(policy,
-            word_freqs.begin(), word_freqs.end(),
+            term_freqs.begin(), term_freqs.end(),
             words.begin(),
-            [](const auto& item) { return &item.first; }
+            [this](const TermFrequency& item) { return terms_[item.term_id]; }
         );
 
         std::for_each(policy,
             words.begin(), words.end(), 
-            [this, document_id](std::string* item) {
-                word_to_document_freqs_.at(*item).erase(document_id);
+            [this, document_id](std::string_view item) {
+                word_to_document_freqs_.at(item).erase(document_id);
         });
+        }
 
-        document_to_word_freqs_.erase(document_id);
+        const int ordinal = documents_.at(document_id).ordinal;
+        total_document_length_ -= document_lengths_[ordinal];
+        document_ids_by_ordinal_[ordinal] = -1;
+        document_to_word_freqs_[ordinal].clear();
+        document_to_word_freqs_[ordinal].shrink_to_fit();
         documents_.erase(document_id);
         document_ids_.erase(document_id);
     }
@@ -0,0 +1,375 @@
+#include "segmented_search_server.h"
+
+using std::operator""s;
+
+SegmentedSearchServer::SegmentedSearchServer(const std::string& stop_words_text, SegmentedIndexOptions options)
+    : SegmentedSearchServer(SplitIntoWords(stop_words_text), options) {
+}
+
+SegmentedSearchServer::SegmentedSearchServer(std::string_view stop_words_text, SegmentedIndexOptions options)
+    : SegmentedSearchServer(SplitIntoWords(stop_words_text), options) {
+}
+
+SegmentedSearchServer::~SegmentedSearchServer() {
+    {
+        std::lock_guard guard(merge_mutex_);
+        stopping_ = true;
+    }
+    merge_requested_.notify_all();
+    if (merge_thread_.joinable()) {
+        merge_thread_.join();
+    }
+}
+
+//Добавление документа в изменяемый сегмент; при достижении порога сегмент сбрасывается
+void SegmentedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                        const std::vector<int>& ratings) {
+    if (ratings.empty()) {
+        throw std::invalid_argument("Empty ratings"s);
+    }
+    std::lock_guard write_guard(write_mutex_);
+    if (document_id < 0 || document_ids_.count(document_id) > 0) {
+        throw std::invalid_argument("Invalid document_id"s);
+    }
+    // При приведении регистра слова указывают в копию текста: в словарь сегмента они все равно копируются
+    std::vector<char> folded_text(options_.case_folding == CaseFolding::ASCII ? document.size() : 0);
+    const auto words = SplitIntoWordsNoStop(document, folded_text.empty() ? nullptr : folded_text.data());
+
+    int rating_sum = 0;
+    for (const int rating : ratings) {
+        rating_sum += rating;
+    }
+    {
+        std::lock_guard guard(mutable_mutex_);
+        const int length = static_cast<int>(words.size());
+        const double inv_word_count = 1.0 / words.size();
+        for (const std::string_view word : words) {
+            auto it = mutable_segment_.word_to_document_freqs.find(word);
+            if (it == mutable_segment_.word_to_document_freqs.end()) {
+                it = mutable_segment_.word_to_document_freqs.emplace(std::string(word), std::map<int, double>{}).first;
+            }
+            it->second[document_id] += inv_word_count;
+        }
+        mutable_segment_.documents.emplace(document_id, IndexSegment::DocumentInfo{
+            document_id, rating_sum / static_cast<int>(ratings.size()), status, length});
+    }
+    document_ids_.insert(document_id);
+
+    if (mutable_segment_.documents.size() >= options_.flush_document_count) {
+        FlushLocked();
+    }
+}
+
+//Удаление: из изменяемого сегмента документ убирается сразу, в неизменяемом ставится отметка
+void SegmentedSearchServer::RemoveDocument(int document_id) {
+    std::lock_guard write_guard(write_mutex_);
+    if (document_ids_.erase(document_id) == 0) {
+        return;
+    }
+    {
+        std::lock_guard guard(mutable_mutex_);
+        if (mutable_segment_.documents.erase(document_id) > 0) {
+            auto& word_freqs = mutable_segment_.word_to_document_freqs;
+            for (auto it = word_freqs.begin(); it != word_freqs.end();) {
+                it->second.erase(document_id);
+                it = it->second.empty() ? word_freqs.erase(it) : std::next(it);
+            }
+            return;
+        }
+    }
+    for (const auto& segment : *GetSegments()) {
+        if (segment->MarkDeleted(document_id)) {
+            break;
+        }
+    }
+}
+
+int SegmentedSearchServer::GetDocumentCount() const {
+    std::lock_guard write_guard(write_mutex_);
+    return static_cast<int>(document_ids_.size());
+}
+
+std::vector<SegmentStats> SegmentedSearchServer::GetSegmentStats() const {
+    std::vector<SegmentStats> result;
+    for (const auto& segment : *GetSegments()) {
+        result.push_back({segment->GetDocuments().size(), segment->GetLiveDocumentCount(),
+                          segment->GetTerms().size(), segment->GetPostingCount()});
+    }
+    return result;
+}
+
+void SegmentedSearchServer::Flush() {
+    std::lock_guard write_guard(write_mutex_);
+    FlushLocked();
+}
+
+void SegmentedSearchServer::WaitForMerges() {
+    std::unique_lock lock(merge_mutex_);
+    merge_idle_.wait(lock, [this] {
+        return !is_merge_requested_ && !is_merging_;
+    });
+}
+
+std::vector<std::string_view> SegmentedSearchServer::SplitIntoWordsNoStop(std::string_view text, char* folded_text) const {
+    std::vector<std::string_view> words;
+    ForEachNormalizedWord(stop_words_, text, folded_text, false,
+        [&words](std::string_view word, bool) {
+            words.push_back(word);
+    });
+    return words;
+}
+
+//Создание списков плюс- и минус-слов; префиксы раскрываются позже, по словам снимка
+SegmentedSearchServer::Query SegmentedSearchServer::ParseQuery(std::string_view text) const {
+    Query result;
+    char* folded_text = nullptr;
+    if (options_.case_folding == CaseFolding::ASCII) {
+        result.folded_text.resize(text.size());
+        folded_text = result.folded_text.data();
+    }
+    ForEachNormalizedWord(stop_words_, text, folded_text, true, [&result](std::string_view word, bool is_minus) {
+        if (word.back() == '*') {
+            if (word.size() == 1) {
+                throw std::invalid_argument("Пустой префикс"s);
+            }
+            (is_minus ? result.minus_prefixes : result.plus_prefixes).push_back(word.substr(0, word.size() - 1));
+        } else {
+            (is_minus ? result.minus_words : result.plus_words).push_back(word);
+        }
+    });
+    return result;
+}
+
+//Слова с префиксом из словарей всех сегментов. Из каждого сегмента берется не больше max_count первых слов,
+//поэтому объединение, усеченное до max_count, совпадает с первыми словами общего словаря
+void SegmentedSearchServer::ExpandPrefix(const Segments& segments, std::string_view prefix, size_t max_count,
+                                         std::deque<std::string>& storage, std::vector<std::string_view>& words) const {
+    std::vector<std::string_view> found;
+    for (const auto& segment : segments) {
+        const auto& terms = segment->GetTerms();
+        size_t count = 0;
+        for (auto it = std::lower_bound(terms.begin(), terms.end(), prefix);
+             it != terms.end() && std::string_view(*it).substr(0, prefix.size()) == prefix && count < max_count; ++it, ++count) {
+            found.push_back(*it);
+        }
+    }
+    const auto& word_freqs = mutable_segment_.word_to_document_freqs;
+    size_t count = 0;
+    for (auto it = word_freqs.lower_bound(prefix);
+         it != word_freqs.end() && std::string_view(it->first).substr(0, prefix.size()) == prefix && count < max_count; ++it, ++count) {
+        found.push_back(it->first);
+    }
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    found.resize(std::min(found.size(), max_count));
+    // Слова изменяемого сегмента живут только под блокировкой, поэтому копируются
+    for (const std::string_view word : found) {
+        words.push_back(storage.emplace_back(word));
+    }
+}
+
+//Снимок для запроса: неизменяемые сегменты, срез изменяемого сегмента и статистика по всем сегментам
+SegmentedSearchServer::QuerySnapshot SegmentedSearchServer::TakeSnapshot(Query& query) const {
+    QuerySnapshot snapshot;
+
+    size_t document_count = 0;
+    size_t total_length = 0;
+    {
+        // Сброс меняет оба списка под исключительной блокировкой, поэтому снимок согласован
+        std::shared_lock lock(mutable_mutex_);
+        snapshot.segments = *GetSegments();
+        for (const std::string_view prefix : query.plus_prefixes) {
+            ExpandPrefix(snapshot.segments, prefix, static_cast<size_t>(MAX_PREFIX_EXPANSIONS), query.expanded_words, query.plus_words);
+        }
+        for (const std::string_view prefix : query.minus_prefixes) {
+            ExpandPrefix(snapshot.segments, prefix, std::numeric_limits<size_t>::max(), query.expanded_words, query.minus_words);
+        }
+        for (auto* words : {&query.plus_words, &query.minus_words}) {
+            std::sort(words->begin(), words->end());
+            words->erase(std::unique(words->begin(), words->end()), words->end());
+        }
+        std::vector<std::string_view> query_words = query.plus_words;
+        query_words.insert(query_words.end(), query.minus_words.begin(), query.minus_words.end());
+        snapshot.segments.push_back(BuildSegment(mutable_segment_, &query_words));
+        document_count = mutable_segment_.documents.size();
+        for (const auto& [document_id, document] : mutable_segment_.documents) {
+            total_length += document.length;
+        }
+    }
+
+    for (size_t i = 0; i + 1 < snapshot.segments.size(); ++i) {
+        document_count += snapshot.segments[i]->GetLiveDocumentCount();
+        total_length += snapshot.segments[i]->GetLiveDocumentLength();
+    }
+    snapshot.statistics.document_count = static_cast<int>(document_count);
+    snapshot.statistics.average_document_length = document_count > 0 ? total_length * 1.0 / document_count : 0.0;
+
+    // Число документов со словом хранится в каждом сегменте, поэтому IDF не требует прохода по записям
+    for (const std::string_view word : query.plus_words) {
+        size_t document_freq = 0;
+        for (const auto& segment : snapshot.segments) {
+            document_freq += segment->GetLiveDocumentFreq(word);
+        }
+        snapshot.plus_word_document_freqs.push_back(static_cast<int>(document_freq));
+    }
+    return snapshot;
+}
+
+std::shared_ptr<const SegmentedSearchServer::Segments> SegmentedSearchServer::GetSegments() const {
+    std::lock_guard guard(segments_mutex_);
+    return segments_;
+}
+
+std::shared_ptr<IndexSegment> SegmentedSearchServer::BuildSegment(const MutableSegment& segment, const std::vector<std::string_view>* words) {
+    std::vector<std::pair<std::string_view, const std::map<int, double>*>> word_freqs;
+    if (words == nullptr) {
+        for (const auto& [word, freqs] : segment.word_to_document_freqs) {
+            word_freqs.push_back({word, &freqs});
+        }
+    } else {
+        for (const std::string_view word : *words) {
+            const auto it = segment.word_to_document_freqs.find(word);
+            if (it != segment.word_to_document_freqs.end()) {
+                word_freqs.push_back({it->first, &it->second});
+            }
+        }
+        std::sort(word_freqs.begin(), word_freqs.end());
+    }
+
+    std::vector<IndexSegment::DocumentInfo> documents;
+    std::map<int, size_t> document_indexes;
+    if (words == nullptr) {
+        for (const auto& [document_id, document] : segment.documents) {
+            document_indexes.emplace(document_id, documents.size());
+            documents.push_back(document);
+        }
+    } else {
+        for (const auto& [word, freqs] : word_freqs) {
+            for (const auto& [document_id, term_freq] : *freqs) {
+                document_indexes.emplace(document_id, 0);
+            }
+        }
+        for (auto& [document_id, index] : document_indexes) {
+            index = documents.size();
+            documents.push_back(segment.documents.at(document_id));
+        }
+    }
+
+    std::vector<std::string> terms;
+    std::vector<size_t> offsets{0};
+    std::vector<IndexSegment::Posting> postings;
+    for (const auto& [word, freqs] : word_freqs) {
+        terms.emplace_back(word);
+        for (const auto& [document_id, term_freq] : *freqs) {
+            postings.push_back({document_indexes.at(document_id), term_freq});
+        }
+        offsets.push_back(postings.size());
+    }
+    return std::make_shared<IndexSegment>(std::move(terms), std::move(offsets), std::move(postings), std::move(documents));
+}
+
+//Сброс изменяемого сегмента: сегмент строится без исключительной блокировки, запросы ждут только подмену
+void SegmentedSearchServer::FlushLocked() {
+    if (mutable_segment_.documents.empty()) {
+        return;
+    }
+    const auto flushed = BuildSegment(mutable_segment_, nullptr);
+    MutableSegment retired;
+    {
+        std::lock_guard guard(mutable_mutex_);
+        auto segments = std::make_shared<Segments>(*GetSegments());
+        segments->push_back(flushed);
+        {
+            std::lock_guard segments_guard(segments_mutex_);
+            segments_ = std::move(segments);
+        }
+        std::swap(retired, mutable_segment_);
+    }
+
+    {
+        std::lock_guard guard(merge_mutex_);
+        is_merge_requested_ = true;
+        if (!merge_thread_.joinable()) {
+            merge_thread_ = std::thread([this] {
+                MergeLoop();
+            });
+        }
+    }
+    merge_requested_.notify_one();
+}
+
+//Фоновое слияние: поток запускается при первом сбросе
+void SegmentedSearchServer::MergeLoop() {
+    std::unique_lock lock(merge_mutex_);
+    while (true) {
+        merge_requested_.wait(lock, [this] {
+            return stopping_ || is_merge_requested_;
+        });
+        if (stopping_) {
+            is_merge_requested_ = false;
+            merge_idle_.notify_all();
+            return;
+        }
+        is_merge_requested_ = false;
+        is_merging_ = true;
+        lock.unlock();
+        while (!stopping_ && MergeOnce()) {
+        }
+        lock.lock();
+        is_merging_ = false;
+        merge_idle_.notify_all();
+    }
+}
+
+//Ярусная политика: ярус сегмента - степень merge_factor в отношении его размера к порогу сброса
+size_t SegmentedSearchServer::GetTier(size_t document_count) const {
+    size_t tier = 0;
+    for (size_t size = options_.flush_document_count * options_.merge_factor; size <= document_count; size *= options_.merge_factor) {
+        ++tier;
+    }
+    return tier;
+}
+
+bool SegmentedSearchServer::MergeOnce() {
+    const auto segments = GetSegments();
+    std::map<size_t, Segments> tiers;
+    for (const auto& segment : *segments) {
+        tiers[GetTier(segment->GetLiveDocumentCount())].push_back(segment);
+    }
+    Segments inputs;
+    for (auto& [tier, tier_segments] : tiers) {
+        if (tier_segments.size() >= options_.merge_factor) {
+            tier_segments.resize(options_.merge_factor);
+            inputs = std::move(tier_segments);
+            break;
+        }
+    }
+    if (inputs.empty()) {
+        return false;
+    }
+
+    const auto merged = IndexSegment::Merge(inputs);
+
+    // Удаления, пришедшие во время слияния, переносятся в новый сегмент
+    std::lock_guard write_guard(write_mutex_);
+    for (const auto& input : inputs) {
+        const auto& documents = input->GetDocuments();
+        for (size_t i = 0; i < documents.size(); ++i) {
+            if (input->IsDeleted(i)) {
+                merged->MarkDeleted(documents[i].document_id);
+            }
+        }
+    }
+    auto next_segments = std::make_shared<Segments>();
+    for (const auto& segment : *GetSegments()) {
+        if (std::find(inputs.begin(), inputs.end(), segment) == inputs.end()) {
+            next_segments->push_back(segment);
+        }
+    }
+    if (merged->GetLiveDocumentCount() > 0) {
+        next_segments->push_back(merged);
+    }
+    std::lock_guard segments_guard(segments_mutex_);
+    segments_ = std::move(next_segments);
+    return true;
+}
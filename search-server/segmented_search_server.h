@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "document.h"
+#include "index_segment.h"
+#include "scoring_models.h"
+#include "search_server.h"
+#include "stop_words.h"
+#include "string_processing.h"
+
+struct SegmentedIndexOptions {
+    // Изменяемый сегмент сбрасывается в неизменяемый при таком числе документов
+    size_t flush_document_count = 4096;
+    // Столько сегментов одного яруса сливаются в один сегмент следующего яруса
+    size_t merge_factor = 4;
+    // Как у SearchServer: при ASCII слова документов, запросов и стоп-слова приводятся к нижнему регистру
+    CaseFolding case_folding = CaseFolding::NONE;
+};
+
+struct SegmentStats {
+    size_t document_count = 0;
+    size_t live_document_count = 0;
+    size_t term_count = 0;
+    size_t posting_count = 0;
+};
+
+// Индекс в духе LSM: новые документы попадают в небольшой изменяемый сегмент, который по порогу
+// превращается в неизменяемый; фоновый поток сливает сегменты по ярусам. Запрос берет снимок списка
+// сегментов и читает их без блокировок, IDF считается по всем сегментам сразу. Слова разбираются
+// так же, как в SearchServer, включая префиксы cat* и -cat*, поэтому запрос дает те же документы.
+class SegmentedSearchServer {
+public:
+    template <typename StringContainer>
+    explicit SegmentedSearchServer(const StringContainer& stop_words, SegmentedIndexOptions options = {});
+    explicit SegmentedSearchServer(const std::string& stop_words_text, SegmentedIndexOptions options = {});
+    explicit SegmentedSearchServer(std::string_view stop_words_text, SegmentedIndexOptions options = {});
+    ~SegmentedSearchServer();
+
+    SegmentedSearchServer(const SegmentedSearchServer&) = delete;
+    SegmentedSearchServer& operator=(const SegmentedSearchServer&) = delete;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    template <typename ScoringModel = TfIdfScoring, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    template <typename ScoringModel = TfIdfScoring>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    int GetDocumentCount() const;
+    std::vector<SegmentStats> GetSegmentStats() const;
+
+    // Сбрасывает изменяемый сегмент, даже если порог не достигнут
+    void Flush();
+    // Дожидается, пока фоновый поток не сольет все сегменты, подходящие под политику слияния
+    void WaitForMerges();
+
+private:
+    using Segments = std::vector<std::shared_ptr<IndexSegment>>;
+
+    struct MutableSegment {
+        std::map<std::string, std::map<int, double>, std::less<>> word_to_document_freqs;
+        std::map<int, IndexSegment::DocumentInfo> documents;
+    };
+
+    struct Query {
+        std::vector<std::string_view> plus_words;
+        std::vector<std::string_view> minus_words;
+        // Префиксы запроса без '*', раскрываются по словам снимка
+        std::vector<std::string_view> plus_prefixes;
+        std::vector<std::string_view> minus_prefixes;
+        // Слова запроса в нижнем регистре, если индекс приводит регистр
+        std::vector<char> folded_text;
+        // Слова сегментов, подставленные вместо префиксов; deque не перемещает строки
+        std::deque<std::string> expanded_words;
+    };
+
+    struct QuerySnapshot {
+        // Последний сегмент - слова запроса из изменяемого сегмента
+        Segments segments;
+        std::vector<int> plus_word_document_freqs;
+        CorpusStatistics statistics;
+    };
+
+    // folded_text - как в ForEachNormalizedWord (stop_words.h)
+    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text, char* folded_text) const;
+    Query ParseQuery(std::string_view text) const;
+    // Раскрывает префиксы запроса и убирает повторы слов
+    QuerySnapshot TakeSnapshot(Query& query) const;
+    // Вызывается под mutable_mutex_. Как SearchServer::ExpandPrefix, но по словарям всех сегментов
+    void ExpandPrefix(const Segments& segments, std::string_view prefix, size_t max_count,
+                      std::deque<std::string>& storage, std::vector<std::string_view>& words) const;
+    std::shared_ptr<const Segments> GetSegments() const;
+
+    // words == nullptr - весь сегмент, иначе только эти слова и документы, где они встречаются
+    static std::shared_ptr<IndexSegment> BuildSegment(const MutableSegment& segment, const std::vector<std::string_view>* words);
+    void FlushLocked();
+    void MergeLoop();
+    bool MergeOnce();
+    size_t GetTier(size_t document_count) const;
+
+    const SegmentedIndexOptions options_;
+    const StopWordSet stop_words_;
+
+    // Порядок захвата: write_mutex_, затем mutable_mutex_, затем segments_mutex_
+    mutable std::mutex write_mutex_;
+    std::set<int> document_ids_;
+
+    mutable std::shared_mutex mutable_mutex_;
+    MutableSegment mutable_segment_;
+
+    mutable std::mutex segments_mutex_;
+    std::shared_ptr<const Segments> segments_ = std::make_shared<Segments>();
+
+    std::mutex merge_mutex_;
+    std::condition_variable merge_requested_;
+    std::condition_variable merge_idle_;
+    bool is_merge_requested_ = false;
+    bool is_merging_ = false;
+    std::atomic<bool> stopping_ = false;
+    std::thread merge_thread_;
+};
+
+template <typename StringContainer>
+SegmentedSearchServer::SegmentedSearchServer(const StringContainer& stop_words, SegmentedIndexOptions options)
+    : options_(options)
+    , stop_words_(MakeUniqueNonEmptyStrings(stop_words), options.case_folding) {
+    if (options_.flush_document_count == 0 || options_.merge_factor < 2) {
+        throw std::invalid_argument("Invalid segmented index options");
+    }
+}
+
+template <typename ScoringModel, typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    const QueryArena::Scope arena;
+    Query query = ParseQuery(raw_query);
+    const QuerySnapshot snapshot = TakeSnapshot(query);
+    const ScoringModel scoring_model(snapshot.statistics);
+
+    std::pmr::vector<Document> matched_documents(QueryArena::GetResource());
+    for (const auto& segment : snapshot.segments) {
+        const auto& documents = segment->GetDocuments();
+        std::map<size_t, double> document_to_relevance;
+        for (size_t i = 0; i < query.plus_words.size(); ++i) {
+            if (snapshot.plus_word_document_freqs[i] == 0) {
+                continue;
+            }
+            const double inverse_document_freq = scoring_model.ComputeInverseDocumentFreq(snapshot.plus_word_document_freqs[i]);
+            const auto [begin, end] = segment->GetPostings(query.plus_words[i]);
+            for (auto posting = begin; posting != end; ++posting) {
+                const auto& document = documents[posting->document_index];
+                if (!segment->IsDeleted(posting->document_index)
+                    && document_predicate(document.document_id, document.status, document.rating)) {
+                    document_to_relevance[posting->document_index] += scoring_model.ComputeTermScore(
+                        posting->term_freq, inverse_document_freq, document.length);
+                }
+            }
+        }
+        for (const std::string_view word : query.minus_words) {
+            const auto [begin, end] = segment->GetPostings(word);
+            for (auto posting = begin; posting != end; ++posting) {
+                document_to_relevance.erase(posting->document_index);
+            }
+        }
+        for (const auto [document_index, relevance] : document_to_relevance) {
+            matched_documents.push_back({ documents[document_index].document_id, relevance, documents[document_index].rating });
+        }
+    }
+
+    sort(matched_documents.begin(), matched_documents.end(), SearchServer::IsMoreRelevant);
+    return SearchServer::CopyTopDocuments(matched_documents);
+}
+
+template <typename ScoringModel>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments<ScoringModel>(raw_query,
+        [status](int document_id, DocumentStatus new_status, int rating) {
+            return new_status == status;
+    });
+}
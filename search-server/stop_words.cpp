@@ -0,0 +1,59 @@
+#include "stop_words.h"
+
+#include <algorithm>
+
+StopWordSet::StopWordSet(const std::set<std::string, std::less<>>& words, CaseFolding case_folding)
+    : words_(words.begin(), words.end()) {
+    for (const std::string& word : words_) {
+        if (std::any_of(word.begin(), word.end(), [](char c) { return c >= '\0' && c < ' '; })) {
+            throw std::invalid_argument("Some of stop words are invalid");
+        }
+    }
+    if (case_folding == CaseFolding::ASCII) {
+        for (std::string& word : words_) {
+            FoldCaseAscii(word.data(), word.size());
+        }
+        std::sort(words_.begin(), words_.end());
+        words_.erase(std::unique(words_.begin(), words_.end()), words_.end());
+    }
+
+    slots_.assign(NextPowerOfTwo(words_.size() * 2 + 2), -1);
+    table_mask_ = slots_.size() - 1;
+    for (size_t i = 0; i < words_.size(); ++i) {
+        uint64_t slot = MixStopWordHash(HashStopWord(words_[i]), 0) & table_mask_;
+        while (slots_[slot] >= 0) {
+            slot = (slot + 1) & table_mask_;
+        }
+        slots_[slot] = static_cast<int>(i);
+    }
+}
+
+//Поиск слова: одна проверка в идеальной таблице или пробирование до пустой ячейки
+bool StopWordSet::Contains(std::string_view word) const {
+    if (words_.empty()) {
+        return false;
+    }
+    const uint64_t hash = HashStopWord(word);
+    if (!displacements_.empty()) {
+        for (int i = slots_[MixStopWordHash(hash, displacements_[hash % displacements_.size()]) & table_mask_]; i >= 0; i = next_words_[i]) {
+            if (words_[i] == word) {
+                return true;
+            }
+        }
+        return false;
+    }
+    for (uint64_t slot = MixStopWordHash(hash, 0) & table_mask_; slots_[slot] >= 0; slot = (slot + 1) & table_mask_) {
+        if (words_[slots_[slot]] == word) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::string>::const_iterator StopWordSet::begin() const {
+    return words_.begin();
+}
+
+std::vector<std::string>::const_iterator StopWordSet::end() const {
+    return words_.end();
+}
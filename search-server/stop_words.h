@@ -0,0 +1,282 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "string_processing.h"
+
+// Хеш не различает регистр ASCII, поэтому таблица, построенная на этапе компиляции,
+// остается верной и для сервера, который приводит слова к нижнему регистру
+constexpr uint64_t HashStopWord(std::string_view word) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c : word) {
+        hash ^= static_cast<unsigned char>(ToLowerAscii(c));
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+constexpr uint64_t MixStopWordHash(uint64_t hash, uint64_t displacement) {
+    uint64_t mixed = hash + displacement * 0x9E3779B97F4A7C15ull;
+    mixed ^= mixed >> 33;
+    mixed *= 0xFF51AFD7ED558CCDull;
+    mixed ^= mixed >> 33;
+    mixed *= 0xC4CEB9FE1A85EC53ull;
+    mixed ^= mixed >> 33;
+    return mixed;
+}
+
+constexpr bool IsEqualIgnoringCase(std::string_view lhs, std::string_view rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (ToLowerAscii(lhs[i]) != ToLowerAscii(rhs[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr size_t NextPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result *= 2;
+    }
+    return result;
+}
+
+// Идеальная хеш-таблица стоп-слов (hash-and-displace), которая строится во время компиляции.
+// Слова, различающиеся только регистром, имеют один хеш: в таблице лежит первое из них, остальные
+// связаны с ним цепочкой, поэтому без приведения регистра сравнение остается точным
+template <size_t N>
+class StaticStopWords {
+public:
+    static constexpr size_t TABLE_SIZE = NextPowerOfTwo(N * 2 + 2);
+    static constexpr size_t BUCKET_COUNT = N / 2 + 1;
+
+    constexpr explicit StaticStopWords(const std::array<std::string_view, N>& words)
+        : words_(words) {
+        Build();
+    }
+
+    constexpr bool Contains(std::string_view word) const {
+        const uint64_t hash = HashStopWord(word);
+        for (int i = slots_[MixStopWordHash(hash, displacements_[hash % BUCKET_COUNT]) & (TABLE_SIZE - 1)]; i >= 0; i = next_words_[i]) {
+            if (words_[i] == word) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    constexpr const std::array<std::string_view, N>& GetWords() const {
+        return words_;
+    }
+
+    constexpr const std::array<int, TABLE_SIZE>& GetSlots() const {
+        return slots_;
+    }
+
+    constexpr const std::array<uint64_t, BUCKET_COUNT>& GetDisplacements() const {
+        return displacements_;
+    }
+
+    // Следующее слово, равное данному без учета регистра, или -1
+    constexpr const std::array<int, N + 1>& GetNextWords() const {
+        return next_words_;
+    }
+
+private:
+    static constexpr uint64_t MAX_DISPLACEMENT = 1 << 20;
+
+    constexpr void Build() {
+        std::array<uint64_t, N + 1> hashes{};
+        std::array<bool, N + 1> is_chained{};
+        std::array<size_t, BUCKET_COUNT> bucket_sizes{};
+        for (int& next_word : next_words_) {
+            next_word = -1;
+        }
+        for (size_t i = 0; i < N; ++i) {
+            if (words_[i].empty()) {
+                throw std::invalid_argument("Empty stop word");
+            }
+            for (const char c : words_[i]) {
+                if (c >= '\0' && c < ' ') {
+                    throw std::invalid_argument("Some of stop words are invalid");
+                }
+            }
+            hashes[i] = HashStopWord(words_[i]);
+            for (size_t j = 0; j < i && !is_chained[i]; ++j) {
+                if (!is_chained[j] && IsEqualIgnoringCase(words_[i], words_[j])) {
+                    size_t last = j;
+                    while (next_words_[last] >= 0) {
+                        last = static_cast<size_t>(next_words_[last]);
+                    }
+                    next_words_[last] = static_cast<int>(i);
+                    is_chained[i] = true;
+                }
+            }
+            if (!is_chained[i]) {
+                ++bucket_sizes[hashes[i] % BUCKET_COUNT];
+            }
+        }
+        for (int& slot : slots_) {
+            slot = -1;
+        }
+
+        // Сначала размещаются самые большие корзины, пока в таблице много свободных ячеек
+        std::array<size_t, BUCKET_COUNT> bucket_order{};
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            bucket_order[i] = i;
+        }
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            for (size_t j = i + 1; j < BUCKET_COUNT; ++j) {
+                if (bucket_sizes[bucket_order[j]] > bucket_sizes[bucket_order[i]]) {
+                    const size_t tmp = bucket_order[i];
+                    bucket_order[i] = bucket_order[j];
+                    bucket_order[j] = tmp;
+                }
+            }
+        }
+
+        for (const size_t bucket : bucket_order) {
+            if (bucket_sizes[bucket] == 0) {
+                break;
+            }
+            bool placed = false;
+            for (uint64_t displacement = 0; !placed && displacement < MAX_DISPLACEMENT; ++displacement) {
+                placed = TryPlaceBucket(hashes, is_chained, bucket, displacement);
+            }
+            if (!placed) {
+                throw std::invalid_argument("Stop word hashes collide");
+            }
+        }
+    }
+
+    constexpr bool TryPlaceBucket(const std::array<uint64_t, N + 1>& hashes, const std::array<bool, N + 1>& is_chained,
+                                  size_t bucket, uint64_t displacement) {
+        std::array<size_t, N + 1> bucket_slots{};
+        size_t placed_count = 0;
+        for (size_t i = 0; i < N; ++i) {
+            if (is_chained[i] || hashes[i] % BUCKET_COUNT != bucket) {
+                continue;
+            }
+            const size_t slot = MixStopWordHash(hashes[i], displacement) & (TABLE_SIZE - 1);
+            if (slots_[slot] >= 0) {
+                return false;
+            }
+            for (size_t j = 0; j < placed_count; ++j) {
+                if (bucket_slots[j] == slot) {
+                    return false;
+                }
+            }
+            bucket_slots[placed_count++] = slot;
+        }
+        placed_count = 0;
+        for (size_t i = 0; i < N; ++i) {
+            if (!is_chained[i] && hashes[i] % BUCKET_COUNT == bucket) {
+                slots_[bucket_slots[placed_count++]] = static_cast<int>(i);
+            }
+        }
+        displacements_[bucket] = displacement;
+        return true;
+    }
+
+    std::array<std::string_view, N> words_{};
+    std::array<int, TABLE_SIZE> slots_{};
+    std::array<uint64_t, BUCKET_COUNT> displacements_{};
+    std::array<int, N + 1> next_words_{};
+};
+
+template <typename... Words>
+constexpr auto MakeStaticStopWords(Words... words) {
+    return StaticStopWords<sizeof...(Words)>(std::array<std::string_view, sizeof...(Words)>{ std::string_view(words)... });
+}
+
+// Множество стоп-слов сервера: идеальная таблица из StaticStopWords
+// или открытая адресация с линейным пробированием для слов, известных только во время работы
+class StopWordSet {
+public:
+    // Слово со спецсимволами - std::invalid_argument
+    StopWordSet(const std::set<std::string, std::less<>>& words, CaseFolding case_folding);
+
+    template <size_t N>
+    StopWordSet(const StaticStopWords<N>& words, CaseFolding case_folding);
+
+    bool Contains(std::string_view word) const;
+
+    std::vector<std::string>::const_iterator begin() const;
+    std::vector<std::string>::const_iterator end() const;
+
+private:
+    std::vector<std::string> words_;
+    std::vector<int> slots_;
+    // Непустой только для идеальной таблицы
+    std::vector<uint64_t> displacements_;
+    // Цепочки слов, равных без учета регистра; непустой только для идеальной таблицы
+    std::vector<int> next_words_;
+    uint64_t table_mask_ = 0;
+};
+
+template <size_t N>
+StopWordSet::StopWordSet(const StaticStopWords<N>& words, CaseFolding case_folding)
+    : slots_(words.GetSlots().begin(), words.GetSlots().end())
+    , displacements_(words.GetDisplacements().begin(), words.GetDisplacements().end())
+    , next_words_(words.GetNextWords().begin(), words.GetNextWords().end())
+    , table_mask_(StaticStopWords<N>::TABLE_SIZE - 1) {
+    words_.reserve(N);
+    for (const std::string_view word : words.GetWords()) {
+        words_.emplace_back(word);
+        if (case_folding == CaseFolding::ASCII) {
+            FoldCaseAscii(words_.back().data(), words_.back().size());
+        }
+    }
+}
+
+// Единый проход по тексту: проверка символов, приведение регистра и отбрасывание стоп-слов.
+// folded_text - буфер длины text для слов в нижнем регистре (может совпадать с text.data()) или nullptr.
+// В запросе (is_query) минус снимается со слова и передается в on_word(word, is_minus)
+template <typename Callback>
+void ForEachNormalizedWord(const StopWordSet& stop_words, std::string_view text, char* folded_text, bool is_query, Callback on_word) {
+    using namespace std::literals;
+    const char* words_base = folded_text != nullptr ? folded_text : text.data();
+    size_t word_begin = 0;
+    bool is_in_word = false;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        if (i == text.size() || text[i] == ' ') {
+            if (!is_in_word) {
+                continue;
+            }
+            is_in_word = false;
+            std::string_view word(words_base + word_begin, i - word_begin);
+            bool is_minus = false;
+            if (is_query && word[0] == '-') {
+                is_minus = true;
+                word.remove_prefix(1);
+                if (word.empty() || word[0] == '-') {
+                    throw std::invalid_argument("Наличие более одного минуса"s);
+                }
+            }
+            if (!stop_words.Contains(word)) {
+                on_word(word, is_minus);
+            }
+            continue;
+        }
+        const char c = text[i];
+        if (c >= '\0' && c < ' ') {
+            throw std::invalid_argument("Недопустимое слово"s);
+        }
+        if (folded_text != nullptr) {
+            folded_text[i] = ToLowerAscii(c);
+        }
+        if (!is_in_word) {
+            is_in_word = true;
+            word_begin = i;
+        }
+    }
+}
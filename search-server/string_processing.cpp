@@ -14,3 +14,9 @@ std::vector<std::string_view> SplitIntoWords(std::string_view text) {
 
     return result;
 }
+
+void FoldCaseAscii(char* text, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        text[i] = ToLowerAscii(text[i]);
+    }
+}
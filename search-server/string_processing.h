@@ -1,11 +1,23 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <set>
 
 
 
 
+enum class CaseFolding {
+    NONE,
+    ASCII,
+};
+
+constexpr char ToLowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+void FoldCaseAscii(char* text, size_t size);
+
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
 
 template <typename StringContainer>
@@ -0,0 +1,169 @@
+#include "thread_pool.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+thread_local const ThreadPool* ThreadPool::current_pool_ = nullptr;
+thread_local size_t ThreadPool::current_worker_ = 0;
+
+ThreadPool::ThreadPool(ThreadPoolOptions options)
+    : options_(options) {
+    const size_t thread_count = std::max<size_t>(options_.thread_count, 1);
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard guard(sleep_mutex_);
+        stopping_ = true;
+    }
+    task_available_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+//Задача из потока пула кладется в его собственную очередь, внешняя - в очереди по кругу
+void ThreadPool::Submit(std::function<void()> task) {
+    std::call_once(start_flag_, [this] {
+        StartWorkers();
+    });
+    const size_t worker_index = current_pool_ == this && current_worker_ < workers_.size()
+        ? current_worker_
+        : next_worker_.fetch_add(1) % workers_.size();
+    {
+        std::lock_guard guard(workers_[worker_index]->mutex);
+        workers_[worker_index]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard guard(sleep_mutex_);
+        ++queued_tasks_;
+    }
+    task_available_.notify_one();
+}
+
+bool ThreadPool::IsInParallelRegion() const {
+    return current_pool_ == this;
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return workers_.size();
+}
+
+//Счетчики загрузки по каждому потоку пула
+std::vector<WorkerStats> ThreadPool::GetWorkerStats() const {
+    const auto uptime = std::chrono::steady_clock::now() - start_time_;
+    std::vector<WorkerStats> result;
+    result.reserve(workers_.size());
+    for (const auto& worker : workers_) {
+        WorkerStats stats;
+        stats.executed_tasks = worker->executed_tasks.load();
+        stats.stolen_tasks = worker->stolen_tasks.load();
+        stats.failed_tasks = worker->failed_tasks.load();
+        stats.busy_time = std::chrono::nanoseconds(worker->busy_nanoseconds.load());
+        stats.utilisation = uptime.count() > 0 ? stats.busy_time.count() * 1.0 / std::chrono::duration_cast<std::chrono::nanoseconds>(uptime).count() : 0.0;
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void ThreadPool::StartWorkers() {
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->thread = std::thread([this, i] {
+            if (options_.pin_threads) {
+                PinCurrentThread(i);
+            }
+            WorkerLoop(i);
+        });
+    }
+}
+
+void ThreadPool::WorkerLoop(size_t worker_index) {
+    current_pool_ = this;
+    current_worker_ = worker_index;
+    while (true) {
+        if (TryRunTask(worker_index)) {
+            continue;
+        }
+        std::unique_lock lock(sleep_mutex_);
+        task_available_.wait(lock, [this] {
+            return stopping_ || queued_tasks_ > 0;
+        });
+        if (stopping_ && queued_tasks_ == 0) {
+            return;
+        }
+    }
+}
+
+//Сначала берется последняя задача из своей очереди, иначе - первая из чужой.
+//Исключение задачи не выпускается из потока пула, иначе std::terminate
+bool ThreadPool::TryRunTask(size_t worker_index) {
+    std::function<void()> task;
+    bool is_stolen = false;
+    {
+        Worker& own = *workers_[worker_index];
+        std::lock_guard guard(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+    for (size_t offset = 1; !task && offset < workers_.size(); ++offset) {
+        Worker& victim = *workers_[(worker_index + offset) % workers_.size()];
+        std::lock_guard guard(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            is_stolen = true;
+        }
+    }
+    if (!task) {
+        return false;
+    }
+    {
+        std::lock_guard guard(sleep_mutex_);
+        --queued_tasks_;
+    }
+
+    Worker& worker = *workers_[worker_index];
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        task();
+    } catch (...) {
+        ++worker.failed_tasks;
+    }
+    worker.busy_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    ++worker.executed_tasks;
+    if (is_stolen) {
+        ++worker.stolen_tasks;
+    }
+    return true;
+}
+
+void ThreadPool::PinCurrentThread(size_t cpu_index) {
+#ifdef __linux__
+    const unsigned cpu_count = std::max(std::thread::hardware_concurrency(), 1u);
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu_index % cpu_count, &cpu_set);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#else
+    (void)cpu_index;
+#endif
+}
+
+ThreadPool::RegionGuard::RegionGuard(const ThreadPool* pool)
+    : previous_pool_(current_pool_) {
+    current_pool_ = pool;
+}
+
+ThreadPool::RegionGuard::~RegionGuard() {
+    current_pool_ = previous_pool_;
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ThreadPoolOptions {
+    size_t thread_count = std::thread::hardware_concurrency();
+    bool pin_threads = false;
+};
+
+struct WorkerStats {
+    uint64_t executed_tasks = 0;
+    uint64_t stolen_tasks = 0;
+    // Задачи Submit, завершившиеся исключением
+    uint64_t failed_tasks = 0;
+    std::chrono::nanoseconds busy_time{0};
+    double utilisation = 0.0;
+};
+
+// Тег для параллельных перегрузок, выполняющихся на пуле потоков сервера
+struct PoolExecutionPolicy {
+};
+inline constexpr PoolExecutionPolicy pool_par{};
+
+// Тег для FindTopDocuments: пространство id документов делится на диапазоны, каждый поток пула
+// обрабатывает все слова запроса в своем диапазоне
+struct PartitionedExecutionPolicy {
+};
+inline constexpr PartitionedExecutionPolicy partitioned_par{};
+
+class ThreadPool {
+public:
+    explicit ThreadPool(ThreadPoolOptions options = {});
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Исключение из задачи перехватывается и учитывается в WorkerStats::failed_tasks, поток пула продолжает работу.
+    // Результат или ошибку вызывающему коду задача передает сама (например, через std::shared_ptr<std::promise>)
+    void Submit(std::function<void()> task);
+
+    // Вызывает function(i) для всех i из [0, count). Вызывающий поток участвует в работе,
+    // а вложенный вызов из потока пула или из другого ParallelFor выполняется на месте.
+    template <typename Function>
+    void ParallelFor(size_t count, Function function);
+
+    bool IsInParallelRegion() const;
+    size_t GetThreadCount() const;
+    std::vector<WorkerStats> GetWorkerStats() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+        std::atomic<uint64_t> executed_tasks{0};
+        std::atomic<uint64_t> stolen_tasks{0};
+        std::atomic<uint64_t> failed_tasks{0};
+        std::atomic<int64_t> busy_nanoseconds{0};
+        std::thread thread;
+    };
+
+    struct ParallelForState {
+        std::atomic<size_t> next_index{0};
+        size_t completed_count = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable completed;
+    };
+
+    class RegionGuard {
+    public:
+        explicit RegionGuard(const ThreadPool* pool);
+        ~RegionGuard();
+
+    private:
+        const ThreadPool* previous_pool_;
+    };
+
+    void StartWorkers();
+    void WorkerLoop(size_t worker_index);
+    bool TryRunTask(size_t worker_index);
+    static void PinCurrentThread(size_t cpu_index);
+
+    template <typename Function>
+    static void RunChunks(ParallelForState& state, size_t count, size_t chunk_size, Function& function);
+
+    const ThreadPoolOptions options_;
+    const std::chrono::steady_clock::time_point start_time_ = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::once_flag start_flag_;
+    std::atomic<size_t> next_worker_{0};
+    std::atomic<size_t> queued_tasks_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable task_available_;
+    bool stopping_ = false;
+
+    static thread_local const ThreadPool* current_pool_;
+    static thread_local size_t current_worker_;
+};
+
+template <typename Function>
+void ThreadPool::ParallelFor(size_t count, Function function) {
+    if (count == 0) {
+        return;
+    }
+    const size_t thread_count = GetThreadCount();
+    if (count == 1 || thread_count <= 1 || IsInParallelRegion()) {
+        RegionGuard guard(this);
+        for (size_t i = 0; i < count; ++i) {
+            function(i);
+        }
+        return;
+    }
+
+    // Порции мельче, чем число потоков, чтобы потоки с короткими порциями забирали работу у медленных
+    const size_t chunk_size = std::max<size_t>(1, count / (thread_count * 4));
+    const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+    auto state = std::make_shared<ParallelForState>();
+
+    const size_t helper_count = std::min(thread_count, chunk_count - 1);
+    for (size_t i = 0; i < helper_count; ++i) {
+        Submit([this, state, count, chunk_size, &function] {
+            RegionGuard guard(this);
+            RunChunks(*state, count, chunk_size, function);
+        });
+    }
+    {
+        RegionGuard guard(this);
+        RunChunks(*state, count, chunk_size, function);
+    }
+
+    std::unique_lock lock(state->mutex);
+    state->completed.wait(lock, [&state, count] {
+        return state->completed_count == count;
+    });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+template <typename Function>
+void ThreadPool::RunChunks(ParallelForState& state, size_t count, size_t chunk_size, Function& function) {
+    while (true) {
+        const size_t begin = state.next_index.fetch_add(chunk_size);
+        if (begin >= count) {
+            return;
+        }
+        const size_t end = std::min(begin + chunk_size, count);
+        std::exception_ptr error;
+        try {
+            for (size_t i = begin; i < end; ++i) {
+                function(i);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        std::lock_guard guard(state.mutex);
+        if (error && !state.error) {
+            state.error = error;
+        }
+        state.completed_count += end - begin;
+        if (state.completed_count == count) {
+            state.completed.notify_all();
+        }
+    }
+}
@@ -0,0 +1,230 @@
+#include "../query_protocol.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace chrono;
+
+// Запуск: load_generator (--unix PATH | --port N) --queries FILE [--connections C] [--depth D] [--requests N] [--k K]
+// Каждое соединение держит до D запросов в полете; задержка считается от отправки запроса до его ответа.
+struct LoadOptions {
+    string unix_path;
+    int port = 0;
+    string queries_path;
+    size_t connections = 4;
+    size_t depth = 8;
+    size_t requests = 100'000;
+    uint16_t top_k = 5;
+};
+
+LoadOptions ParseOptions(int argc, char* argv[]) {
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const string_view name = argv[i];
+        if (i + 1 == argc) {
+            throw invalid_argument("Missing value for "s + string(name));
+        }
+        const string value = argv[++i];
+        if (name == "--unix"sv) {
+            options.unix_path = value;
+        } else if (name == "--port"sv) {
+            options.port = stoi(value);
+        } else if (name == "--queries"sv) {
+            options.queries_path = value;
+        } else if (name == "--connections"sv) {
+            options.connections = max<size_t>(1, stoul(value));
+        } else if (name == "--depth"sv) {
+            options.depth = max<size_t>(1, stoul(value));
+        } else if (name == "--requests"sv) {
+            options.requests = stoul(value);
+        } else if (name == "--k"sv) {
+            options.top_k = static_cast<uint16_t>(stoul(value));
+        } else {
+            throw invalid_argument("Unknown option "s + string(name));
+        }
+    }
+    if (options.queries_path.empty() || options.unix_path.empty() == (options.port == 0)) {
+        throw invalid_argument("Usage: load_generator (--unix PATH | --port N) --queries FILE [--connections C] [--depth D] [--requests N] [--k K]"s);
+    }
+    return options;
+}
+
+int Connect(const LoadOptions& options) {
+    int fd = -1;
+    int result = -1;
+    if (!options.unix_path.empty()) {
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, options.unix_path.c_str(), sizeof(address.sun_path) - 1);
+        result = connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    } else {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(options.port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        result = connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    }
+    if (fd < 0 || result != 0) {
+        throw system_error(errno, generic_category(), "Cannot connect"s);
+    }
+    return fd;
+}
+
+void SendAll(int fd, const string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const ssize_t size = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw system_error(errno, generic_category(), "send"s);
+        }
+        sent += static_cast<size_t>(size);
+    }
+}
+
+struct ConnectionResult {
+    vector<nanoseconds> latencies;
+    size_t errors = 0;
+};
+
+//Одно соединение: конвейер глубины depth, запросы выбираются из списка по кругу со случайным сдвигом
+ConnectionResult RunConnection(const LoadOptions& options, const vector<string>& queries, size_t request_count, size_t seed) {
+    const int fd = Connect(options);
+    ConnectionResult result;
+    result.latencies.reserve(request_count);
+    unordered_map<uint32_t, steady_clock::time_point> in_flight;
+    uint32_t next_request_id = 0;
+    size_t query_index = mt19937(static_cast<unsigned>(seed))() % queries.size();
+    string input;
+    char buffer[64 * 1024];
+
+    while (result.latencies.size() + result.errors < request_count) {
+        string output;
+        while (in_flight.size() < options.depth && next_request_id < request_count) {
+            QueryRequest request;
+            request.request_id = next_request_id++;
+            request.top_k = options.top_k;
+            request.query = queries[query_index++ % queries.size()];
+            AppendRequest(output, request);
+            in_flight.emplace(request.request_id, steady_clock::now());
+        }
+        SendAll(fd, output);
+
+        const ssize_t size = recv(fd, buffer, sizeof(buffer), 0);
+        if (size <= 0) {
+            if (size < 0 && errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            throw runtime_error("Server closed the connection"s);
+        }
+        input.append(buffer, static_cast<size_t>(size));
+        const auto now = steady_clock::now();
+        size_t offset = 0;
+        QueryResponse response;
+        while (const size_t frame_size = ParseResponse(string_view(input).substr(offset), response)) {
+            offset += frame_size;
+            const auto it = in_flight.find(response.request_id);
+            if (it == in_flight.end()) {
+                continue;
+            }
+            if (response.error.empty()) {
+                result.latencies.push_back(now - it->second);
+            } else {
+                ++result.errors;
+            }
+            in_flight.erase(it);
+        }
+        input.erase(0, offset);
+    }
+    close(fd);
+    return result;
+}
+
+double GetPercentileMicroseconds(const vector<nanoseconds>& sorted_latencies, double percentile) {
+    if (sorted_latencies.empty()) {
+        return 0.0;
+    }
+    const size_t index = min(sorted_latencies.size() - 1, static_cast<size_t>(percentile * sorted_latencies.size()));
+    return duration_cast<nanoseconds>(sorted_latencies[index]).count() / 1000.0;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const LoadOptions options = ParseOptions(argc, argv);
+        vector<string> queries;
+        {
+            ifstream input(options.queries_path);
+            string line;
+            while (getline(input, line)) {
+                if (!line.empty()) {
+                    queries.push_back(line);
+                }
+            }
+        }
+        if (queries.empty()) {
+            throw invalid_argument("No queries in "s + options.queries_path);
+        }
+
+        vector<ConnectionResult> results(options.connections);
+        vector<thread> threads;
+        atomic<bool> has_error = false;
+        const auto start = steady_clock::now();
+        for (size_t i = 0; i < options.connections; ++i) {
+            const size_t request_count = options.requests / options.connections + (i < options.requests % options.connections ? 1 : 0);
+            threads.emplace_back([&, i, request_count] {
+                try {
+                    results[i] = RunConnection(options, queries, request_count, i);
+                } catch (const exception& e) {
+                    cerr << e.what() << endl;
+                    has_error = true;
+                }
+            });
+        }
+        for (thread& thread : threads) {
+            thread.join();
+        }
+        const auto elapsed = steady_clock::now() - start;
+
+        vector<nanoseconds> latencies;
+        size_t errors = 0;
+        for (const ConnectionResult& result : results) {
+            latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+            errors += result.errors;
+        }
+        sort(latencies.begin(), latencies.end());
+        cout << "requests: "s << latencies.size() << ", errors: "s << errors << endl;
+        cout << "throughput: "s << latencies.size() / duration<double>(elapsed).count() << " requests/s"s << endl;
+        cout << "latency us: p50 "s << GetPercentileMicroseconds(latencies, 0.50)
+             << ", p99 "s << GetPercentileMicroseconds(latencies, 0.99)
+             << ", p999 "s << GetPercentileMicroseconds(latencies, 0.999) << endl;
+        return has_error ? 1 : 0;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
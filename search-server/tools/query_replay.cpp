@@ -0,0 +1,314 @@
+#include "../corpus.h"
+#include "../process_queries.h"
+#include "../request_queue.h"
+#include "../search_server.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace chrono;
+
+// Запуск: query_replay --corpus FILE --log FILE [--stop-words "a b"] [--api find|queue|batch] [--batch B]
+//                      [--mode closed|open] [--steps 1,2,4,8] [--clients C] [--requests N]
+// closed: шаг - число клиентов, каждый отправляет следующий запрос после ответа на предыдущий.
+// open: шаг - целевое число запросов в секунду; моменты отправки берутся из журнала и масштабируются
+// к этой частоте, запросы выполняют C клиентов. Задержка с поправкой считается от запланированного момента,
+// поэтому включает ожидание свободного клиента (поправка на coordinated omission).
+// api batch отправляет запросы пачками через ProcessQueries, который ищет только документы со статусом ACTUAL.
+enum class ReplayApi {
+    FIND,
+    QUEUE,
+    BATCH,
+};
+
+enum class ReplayMode {
+    CLOSED,
+    OPEN,
+};
+
+struct ReplayOptions {
+    string corpus_path;
+    string log_path;
+    string stop_words;
+    ReplayApi api = ReplayApi::FIND;
+    size_t batch = 16;
+    ReplayMode mode = ReplayMode::CLOSED;
+    vector<double> steps = { 1, 2, 4, 8 };
+    size_t clients = 4;
+    size_t requests = 0;
+};
+
+struct StepResult {
+    size_t requests = 0;
+    size_t errors = 0;
+    duration<double> elapsed{0};
+    // От начала выполнения до ответа
+    vector<nanoseconds> latencies;
+    // От запланированного момента до ответа
+    vector<nanoseconds> corrected_latencies;
+};
+
+vector<double> ParseSteps(const string& text) {
+    vector<double> steps;
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        const size_t comma = min(text.find(',', begin), text.size());
+        const double step = stod(text.substr(begin, comma - begin));
+        if (step <= 0.0) {
+            throw invalid_argument("Steps must be positive"s);
+        }
+        steps.push_back(step);
+        begin = comma + 1;
+    }
+    return steps;
+}
+
+ReplayOptions ParseOptions(int argc, char* argv[]) {
+    ReplayOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const string_view name = argv[i];
+        if (i + 1 == argc) {
+            throw invalid_argument("Missing value for "s + string(name));
+        }
+        const string value = argv[++i];
+        if (name == "--corpus"sv) {
+            options.corpus_path = value;
+        } else if (name == "--log"sv) {
+            options.log_path = value;
+        } else if (name == "--stop-words"sv) {
+            options.stop_words = value;
+        } else if (name == "--api"sv) {
+            if (value == "find"sv) {
+                options.api = ReplayApi::FIND;
+            } else if (value == "queue"sv) {
+                options.api = ReplayApi::QUEUE;
+            } else if (value == "batch"sv) {
+                options.api = ReplayApi::BATCH;
+            } else {
+                throw invalid_argument("Unknown api "s + value);
+            }
+        } else if (name == "--batch"sv) {
+            options.batch = max<size_t>(1, stoul(value));
+        } else if (name == "--mode"sv) {
+            if (value == "closed"sv) {
+                options.mode = ReplayMode::CLOSED;
+            } else if (value == "open"sv) {
+                options.mode = ReplayMode::OPEN;
+            } else {
+                throw invalid_argument("Unknown mode "s + value);
+            }
+        } else if (name == "--steps"sv) {
+            options.steps = ParseSteps(value);
+        } else if (name == "--clients"sv) {
+            options.clients = max<size_t>(1, stoul(value));
+        } else if (name == "--requests"sv) {
+            options.requests = stoul(value);
+        } else {
+            throw invalid_argument("Unknown option "s + string(name));
+        }
+    }
+    if (options.corpus_path.empty() || options.log_path.empty()) {
+        throw invalid_argument("Usage: query_replay --corpus FILE --log FILE [--stop-words \"a b\"] [--api find|queue|batch] [--batch B] "
+                               "[--mode closed|open] [--steps 1,2,4,8] [--clients C] [--requests N]"s);
+    }
+    return options;
+}
+
+//Запланированные моменты запросов от начала шага. Журнал повторяется по кругу, если запросов больше записей;
+//в открытом режиме его время сжимается или растягивается до средней частоты qps
+vector<nanoseconds> ScheduleRequests(const vector<QueryLogRecord>& log, size_t request_count, double qps) {
+    const double first_ms = log.front().timestamp_ms;
+    double last_ms = first_ms;
+    for (const QueryLogRecord& record : log) {
+        last_ms = max(last_ms, record.timestamp_ms);
+    }
+    // Между повторами журнала выдерживается средний интервал между его записями
+    const double cycle_ms = log.size() > 1 && last_ms > first_ms
+        ? (last_ms - first_ms) * log.size() / (log.size() - 1) : 0.0;
+
+    vector<double> times_ms(request_count);
+    double previous_ms = 0.0;
+    for (size_t i = 0; i < request_count; ++i) {
+        const double time_ms = log[i % log.size()].timestamp_ms - first_ms + (i / log.size()) * cycle_ms;
+        previous_ms = max(previous_ms, time_ms);
+        times_ms[i] = previous_ms;
+    }
+
+    const double target_ms = request_count * 1000.0 / qps;
+    const double recorded_ms = cycle_ms > 0.0 ? request_count * cycle_ms / log.size() : 0.0;
+    vector<nanoseconds> schedule(request_count);
+    for (size_t i = 0; i < request_count; ++i) {
+        // Журнал без разброса времени воспроизводится с равными интервалами
+        const double time_ms = recorded_ms > 0.0 ? times_ms[i] * target_ms / recorded_ms : i * 1000.0 / qps;
+        schedule[i] = duration_cast<nanoseconds>(duration<double, milli>(time_ms));
+    }
+    return schedule;
+}
+
+//Выполнение одного шага: клиенты забирают порции запросов по порядку; в открытом режиме порция ждет
+//запланированного момента своего последнего запроса
+StepResult RunStep(const SearchServer& search_server, const vector<QueryLogRecord>& log, const ReplayOptions& options,
+                   size_t client_count, const vector<nanoseconds>* schedule) {
+    const size_t request_count = options.requests > 0 ? options.requests : log.size();
+    const size_t unit_size = options.api == ReplayApi::BATCH ? options.batch : 1;
+    const size_t unit_count = (request_count + unit_size - 1) / unit_size;
+
+    vector<StepResult> client_results(client_count);
+    atomic<size_t> next_unit = 0;
+    const auto start = steady_clock::now();
+    vector<thread> clients;
+    for (size_t client = 0; client < client_count; ++client) {
+        clients.emplace_back([&, client] {
+            StepResult& result = client_results[client];
+            RequestQueue request_queue(search_server);
+            vector<string> batch;
+            for (size_t unit = next_unit++; unit < unit_count; unit = next_unit++) {
+                const size_t begin = unit * unit_size;
+                const size_t end = min(begin + unit_size, request_count);
+                if (schedule != nullptr) {
+                    this_thread::sleep_until(start + (*schedule)[end - 1]);
+                }
+                const auto unit_start = steady_clock::now();
+                try {
+                    if (options.api == ReplayApi::BATCH) {
+                        batch.clear();
+                        for (size_t i = begin; i < end; ++i) {
+                            batch.push_back(log[i % log.size()].query);
+                        }
+                        ProcessQueries(search_server, batch);
+                    } else {
+                        const QueryLogRecord& record = log[begin % log.size()];
+                        if (options.api == ReplayApi::QUEUE) {
+                            request_queue.AddFindRequest(record.query, record.status);
+                        } else {
+                            search_server.FindTopDocuments(record.query, record.status);
+                        }
+                    }
+                } catch (const exception&) {
+                    result.errors += end - begin;
+                    continue;
+                }
+                const auto unit_end = steady_clock::now();
+                for (size_t i = begin; i < end; ++i) {
+                    result.latencies.push_back(unit_end - unit_start);
+                    if (schedule != nullptr) {
+                        result.corrected_latencies.push_back(unit_end - (start + (*schedule)[i]));
+                    }
+                }
+            }
+        });
+    }
+    for (thread& client : clients) {
+        client.join();
+    }
+
+    StepResult step_result;
+    step_result.elapsed = steady_clock::now() - start;
+    for (StepResult& result : client_results) {
+        step_result.errors += result.errors;
+        step_result.latencies.insert(step_result.latencies.end(), result.latencies.begin(), result.latencies.end());
+        step_result.corrected_latencies.insert(step_result.corrected_latencies.end(),
+                                               result.corrected_latencies.begin(), result.corrected_latencies.end());
+    }
+    step_result.requests = step_result.latencies.size();
+    return step_result;
+}
+
+//Поправка для замкнутого цикла: пока клиент ждал долгий ответ, он не отправил запросы, которые ушли бы
+//через каждый ожидаемый интервал. Они добавляются с задержками L - E, L - 2E, ... (как в HdrHistogram)
+vector<nanoseconds> CorrectClosedLoopLatencies(const vector<nanoseconds>& latencies, nanoseconds expected_interval) {
+    vector<nanoseconds> corrected = latencies;
+    if (expected_interval.count() <= 0) {
+        return corrected;
+    }
+    for (const nanoseconds latency : latencies) {
+        for (nanoseconds missed = latency - expected_interval; missed >= expected_interval; missed -= expected_interval) {
+            corrected.push_back(missed);
+        }
+    }
+    return corrected;
+}
+
+double GetPercentileMicroseconds(const vector<nanoseconds>& sorted_latencies, double percentile) {
+    if (sorted_latencies.empty()) {
+        return 0.0;
+    }
+    const size_t index = min(sorted_latencies.size() - 1, static_cast<size_t>(percentile * sorted_latencies.size()));
+    return sorted_latencies[index].count() / 1000.0;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const ReplayOptions options = ParseOptions(argc, argv);
+        SearchServer search_server(options.stop_words);
+        cerr << "loaded "s << LoadCorpusFile(options.corpus_path, search_server) << " documents"s << endl;
+        vector<QueryLogRecord> log;
+        {
+            ifstream input(options.log_path);
+            if (!input) {
+                throw invalid_argument("Cannot open "s + options.log_path);
+            }
+            log = LoadQueryLog(input);
+        }
+        if (options.api == ReplayApi::BATCH) {
+            // Исключение из ProcessQueries (std::execution::par) завершает программу, поэтому неверные запросы
+            // отбрасываются заранее
+            const size_t record_count = log.size();
+            log.erase(remove_if(log.begin(), log.end(), [&search_server](const QueryLogRecord& record) {
+                try {
+                    search_server.FindTopDocuments(record.query);
+                    return false;
+                } catch (const invalid_argument&) {
+                    return true;
+                }
+            }), log.end());
+            cerr << "skipped "s << record_count - log.size() << " invalid queries"s << endl;
+        }
+        if (log.empty()) {
+            throw invalid_argument("No queries in "s + options.log_path);
+        }
+
+        const size_t request_count = options.requests > 0 ? options.requests : log.size();
+        const bool is_open = options.mode == ReplayMode::OPEN;
+        printf("%10s %9s %7s %12s %10s %10s %10s %12s %12s\n", is_open ? "target_qps" : "clients", "requests", "errors",
+               "throughput", "p50_us", "p99_us", "p999_us", "corr_p99_us", "corr_p999_us");
+        for (const double step : options.steps) {
+            const size_t client_count = is_open ? options.clients : static_cast<size_t>(step);
+            vector<nanoseconds> schedule;
+            if (is_open) {
+                schedule = ScheduleRequests(log, request_count, step);
+            }
+            StepResult result = RunStep(search_server, log, options, client_count, is_open ? &schedule : nullptr);
+
+            const double throughput = result.requests / result.elapsed.count();
+            if (!is_open && result.requests > 0) {
+                // Клиент отправляет запросы подряд, поэтому ожидаемый интервал - средняя задержка
+                nanoseconds total{0};
+                for (const nanoseconds latency : result.latencies) {
+                    total += latency;
+                }
+                result.corrected_latencies = CorrectClosedLoopLatencies(result.latencies, total / result.latencies.size());
+            }
+            sort(result.latencies.begin(), result.latencies.end());
+            sort(result.corrected_latencies.begin(), result.corrected_latencies.end());
+            printf("%10g %9zu %7zu %12.1f %10.1f %10.1f %10.1f %12.1f %12.1f\n", step, result.requests, result.errors, throughput,
+                   GetPercentileMicroseconds(result.latencies, 0.50),
+                   GetPercentileMicroseconds(result.latencies, 0.99),
+                   GetPercentileMicroseconds(result.latencies, 0.999),
+                   GetPercentileMicroseconds(result.corrected_latencies, 0.99),
+                   GetPercentileMicroseconds(result.corrected_latencies, 0.999));
+        }
+        return 0;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,361 @@
+#include "../corpus.h"
+#include "../query_protocol.h"
+#include "../search_server.h"
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Запуск: search_server_daemon --corpus FILE (--unix PATH | --port N) [--stop-words "a b"] [--max-batch N]
+struct DaemonOptions {
+    string corpus_path;
+    string unix_path;
+    int port = 0;
+    string stop_words;
+    size_t max_batch = 256;
+};
+
+struct Connection {
+    uint64_t id = 0;
+    string input;
+    string output;
+    size_t output_offset = 0;
+    uint32_t watched_events = EPOLLIN | EPOLLRDHUP;
+    // Клиент закончил отправку (shutdown(SHUT_WR) или закрытие): соединение закрывается после ответов на все его запросы
+    bool is_input_closed = false;
+    // Запросы соединения в pending_, на которые еще нет ответа
+    size_t pending_count = 0;
+};
+
+struct PendingRequest {
+    int fd;
+    uint64_t connection_id;
+    QueryRequest request;
+};
+
+static volatile sig_atomic_t stopping = 0;
+
+void ThrowSystemError(const string& what) {
+    throw system_error(errno, generic_category(), what);
+}
+
+DaemonOptions ParseOptions(int argc, char* argv[]) {
+    DaemonOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const string_view name = argv[i];
+        if (i + 1 == argc) {
+            throw invalid_argument("Missing value for "s + string(name));
+        }
+        const string value = argv[++i];
+        if (name == "--corpus"sv) {
+            options.corpus_path = value;
+        } else if (name == "--unix"sv) {
+            options.unix_path = value;
+        } else if (name == "--port"sv) {
+            options.port = stoi(value);
+        } else if (name == "--stop-words"sv) {
+            options.stop_words = value;
+        } else if (name == "--max-batch"sv) {
+            options.max_batch = max<size_t>(1, stoul(value));
+        } else {
+            throw invalid_argument("Unknown option "s + string(name));
+        }
+    }
+    if (options.corpus_path.empty() || options.unix_path.empty() == (options.port == 0)) {
+        throw invalid_argument("Usage: search_server_daemon --corpus FILE (--unix PATH | --port N) [--stop-words \"a b\"] [--max-batch N]"s);
+    }
+    return options;
+}
+
+int Listen(const DaemonOptions& options) {
+    int fd = -1;
+    if (!options.unix_path.empty()) {
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (options.unix_path.size() >= sizeof(address.sun_path)) {
+            throw invalid_argument("Unix socket path is too long"s);
+        }
+        strcpy(address.sun_path, options.unix_path.c_str());
+        unlink(options.unix_path.c_str());
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            ThrowSystemError("Cannot bind "s + options.unix_path);
+        }
+    } else {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        const int enable = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(options.port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            ThrowSystemError("Cannot bind port "s + to_string(options.port));
+        }
+    }
+    if (listen(fd, SOMAXCONN) != 0) {
+        ThrowSystemError("Cannot listen"s);
+    }
+    return fd;
+}
+
+class Daemon {
+public:
+    Daemon(const SearchServer& search_server, int listen_fd, size_t max_batch)
+        : search_server_(search_server)
+        , listen_fd_(listen_fd)
+        , max_batch_(max_batch)
+        , epoll_fd_(epoll_create1(EPOLL_CLOEXEC)) {
+        if (epoll_fd_ < 0) {
+            ThrowSystemError("Cannot create epoll"s);
+        }
+        Watch(listen_fd_, EPOLLIN, EPOLL_CTL_ADD);
+    }
+
+    ~Daemon() {
+        for (const auto& [fd, connection] : connections_) {
+            close(fd);
+        }
+        close(epoll_fd_);
+    }
+
+    // Один проход цикла: события всех готовых сокетов, затем одна пачка запросов на пул потоков
+    void Run() {
+        vector<epoll_event> events(256);
+        while (!stopping) {
+            const int count = epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), -1);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                ThrowSystemError("epoll_wait"s);
+            }
+            for (int i = 0; i < count; ++i) {
+                const int fd = events[i].data.fd;
+                if (fd == listen_fd_) {
+                    Accept();
+                    continue;
+                }
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    Close(fd);
+                    continue;
+                }
+                if ((events[i].events & EPOLLOUT) && !Flush(fd)) {
+                    continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+                    Read(fd);
+                }
+            }
+            while (!pending_.empty()) {
+                ProcessBatch();
+            }
+        }
+    }
+
+private:
+    void Watch(int fd, uint32_t events, int operation) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, operation, fd, &event) != 0) {
+            ThrowSystemError("epoll_ctl"s);
+        }
+    }
+
+    void Accept() {
+        while (true) {
+            const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                return;
+            }
+            const int enable = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+            connections_[fd].id = ++last_connection_id_;
+            Watch(fd, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD);
+        }
+    }
+
+    void Close(int fd) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections_.erase(fd);
+    }
+
+    // Все целые кадры становятся в очередь; при конвейерной отправке их может прийти сразу много
+    void Read(int fd) {
+        Connection& connection = connections_.at(fd);
+        char buffer[64 * 1024];
+        while (true) {
+            const ssize_t size = recv(fd, buffer, sizeof(buffer), 0);
+            if (size > 0) {
+                connection.input.append(buffer, static_cast<size_t>(size));
+                continue;
+            }
+            if (size == 0) {
+                connection.is_input_closed = true;
+                break;
+            }
+            if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            if (size < 0 && errno == EINTR) {
+                continue;
+            }
+            Close(fd);
+            return;
+        }
+
+        size_t offset = 0;
+        try {
+            while (true) {
+                QueryRequest request;
+                const size_t frame_size = ParseRequest(string_view(connection.input).substr(offset), request);
+                if (frame_size == 0) {
+                    break;
+                }
+                offset += frame_size;
+                pending_.push_back({fd, connection.id, move(request)});
+                ++connection.pending_count;
+            }
+        } catch (const invalid_argument& e) {
+            cerr << "Closing connection: "s << e.what() << endl;
+            Close(fd);
+            return;
+        }
+        connection.input.erase(0, offset);
+        if (connection.is_input_closed) {
+            // Недописанный кадр уже не будет дополнен
+            connection.input.clear();
+            Flush(fd);
+        }
+    }
+
+    // Возвращает false, если соединение закрыто
+    bool Flush(int fd) {
+        Connection& connection = connections_.at(fd);
+        while (connection.output_offset < connection.output.size()) {
+            const ssize_t size = send(fd, connection.output.data() + connection.output_offset,
+                                      connection.output.size() - connection.output_offset, MSG_NOSIGNAL);
+            if (size < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                Close(fd);
+                return false;
+            }
+            connection.output_offset += static_cast<size_t>(size);
+        }
+        if (connection.output_offset == connection.output.size()) {
+            connection.output.clear();
+            connection.output_offset = 0;
+        }
+        if (connection.is_input_closed && connection.pending_count == 0 && connection.output.empty()) {
+            Close(fd);
+            return false;
+        }
+        // После конца ввода сокет отслеживается только на запись, иначе EPOLLRDHUP приходил бы на каждом проходе
+        const uint32_t events = (connection.is_input_closed ? 0 : EPOLLIN | EPOLLRDHUP) | (connection.output.empty() ? 0 : EPOLLOUT);
+        if (events != connection.watched_events) {
+            Watch(fd, events, EPOLL_CTL_MOD);
+            connection.watched_events = events;
+        }
+        return true;
+    }
+
+    //Пачка запросов выполняется на пуле потоков сервера, как в ProcessQueries; ответы каждого соединения идут в порядке запросов
+    void ProcessBatch() {
+        const size_t batch_size = min(pending_.size(), max_batch_);
+        vector<QueryResponse> responses(batch_size);
+        search_server_.GetThreadPool().ParallelFor(batch_size, [this, &responses](size_t i) {
+            const QueryRequest& request = pending_[i].request;
+            QueryResponse& response = responses[i];
+            response.request_id = request.request_id;
+            try {
+                response.documents = search_server_.FindTopDocuments(request.query, request.status);
+                if (request.top_k > 0 && response.documents.size() > request.top_k) {
+                    response.documents.resize(request.top_k);
+                }
+            } catch (const exception& e) {
+                response.error = e.what();
+            }
+        });
+
+        vector<int> touched_fds;
+        for (size_t i = 0; i < batch_size; ++i) {
+            const auto it = connections_.find(pending_[i].fd);
+            if (it == connections_.end() || it->second.id != pending_[i].connection_id) {
+                continue;
+            }
+            AppendResponse(it->second.output, responses[i]);
+            --it->second.pending_count;
+            touched_fds.push_back(pending_[i].fd);
+        }
+        pending_.erase(pending_.begin(), pending_.begin() + batch_size);
+
+        sort(touched_fds.begin(), touched_fds.end());
+        touched_fds.erase(unique(touched_fds.begin(), touched_fds.end()), touched_fds.end());
+        for (const int fd : touched_fds) {
+            Flush(fd);
+        }
+    }
+
+    const SearchServer& search_server_;
+    const int listen_fd_;
+    const size_t max_batch_;
+    const int epoll_fd_;
+    unordered_map<int, Connection> connections_;
+    uint64_t last_connection_id_ = 0;
+    vector<PendingRequest> pending_;
+};
+
+int main(int argc, char* argv[]) {
+    try {
+        const DaemonOptions options = ParseOptions(argc, argv);
+
+        SearchServer search_server(options.stop_words);
+        const size_t document_count = LoadCorpusFile(options.corpus_path, search_server);
+
+        const int listen_fd = Listen(options);
+        struct sigaction action{};
+        action.sa_handler = [](int) {
+            stopping = 1;
+        };
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+        signal(SIGPIPE, SIG_IGN);
+
+        cerr << "Loaded "s << document_count << " documents, listening on "s
+             << (options.unix_path.empty() ? "127.0.0.1:"s + to_string(options.port) : options.unix_path) << endl;
+        {
+            Daemon daemon(search_server, listen_fd, options.max_batch);
+            daemon.Run();
+        }
+        close(listen_fd);
+        if (!options.unix_path.empty()) {
+            unlink(options.unix_path.c_str());
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <string_view>
+#include <utility>
+
+struct TermFrequency {
+    int term_id;
+    double term_freq;
+};
+
+// Представление прямого индекса документа: непрерывный массив (id слова, tf), упорядоченный по id слова.
+// Элементы - пары (слово, tf), как у прежнего std::map, но в порядке id слов, а не по алфавиту.
+class WordFrequenciesView {
+public:
+    // Элемент собирается при разыменовании и возвращается по значению, поэтому итератор только входной
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::pair<std::string_view, double>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        Iterator(const TermFrequency* position, const std::string_view* terms)
+            : position_(position)
+            , terms_(terms) {
+        }
+
+        value_type operator*() const {
+            return { terms_[position_->term_id], position_->term_freq };
+        }
+        Iterator& operator++() {
+            ++position_;
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            ++position_;
+            return previous;
+        }
+        bool operator==(const Iterator& other) const {
+            return position_ == other.position_;
+        }
+        bool operator!=(const Iterator& other) const {
+            return position_ != other.position_;
+        }
+
+    private:
+        const TermFrequency* position_;
+        const std::string_view* terms_;
+    };
+
+    WordFrequenciesView() = default;
+    WordFrequenciesView(const TermFrequency* begin, const TermFrequency* end, const std::string_view* terms)
+        : begin_(begin)
+        , end_(end)
+        , terms_(terms) {
+    }
+
+    Iterator begin() const {
+        return Iterator(begin_, terms_);
+    }
+    Iterator end() const {
+        return Iterator(end_, terms_);
+    }
+    size_t size() const {
+        return static_cast<size_t>(end_ - begin_);
+    }
+    bool empty() const {
+        return begin_ == end_;
+    }
+
+    // Id слов упорядочены, поэтому два документа можно сравнивать слиянием, не обращаясь к словам
+    const TermFrequency* GetTermFrequencies() const {
+        return begin_;
+    }
+
+    // Для кода, которому нужен поиск по слову или алфавитный порядок
+    std::map<std::string_view, double> ToMap() const {
+        return std::map<std::string_view, double>(begin(), end());
+    }
+
+private:
+    const TermFrequency* begin_ = nullptr;
+    const TermFrequency* end_ = nullptr;
+    const std::string_view* terms_ = nullptr;
+};
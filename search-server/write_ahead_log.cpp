@@ -0,0 +1,355 @@
+#include "write_ahead_log.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "search_server.h"
+
+using namespace std;
+
+enum class WalRecordType : uint8_t {
+    ADD_DOCUMENT = 1,
+    REMOVE_DOCUMENT = 2,
+};
+
+static const array<uint32_t, 256> CRC32_TABLE = [] {
+    array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}();
+
+static uint32_t ComputeCrc32(string_view data) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (const char c : data) {
+        crc = CRC32_TABLE[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+template <typename T>
+static void PutValue(string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+static bool GetValue(string_view& in, T& value) {
+    if (in.size() < sizeof(value)) {
+        return false;
+    }
+    memcpy(&value, in.data(), sizeof(value));
+    in.remove_prefix(sizeof(value));
+    return true;
+}
+
+struct WalRecord {
+    uint64_t lsn = 0;
+    WalRecordType type = WalRecordType::ADD_DOCUMENT;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    vector<int> ratings;
+    string_view text;
+};
+
+// Заголовок записи: размер данных и CRC32 данных, защищенные собственной CRC32
+static constexpr size_t WAL_HEADER_SIZE = 3 * sizeof(uint32_t);
+
+static void PutHeader(string& out, string_view payload) {
+    const size_t header_start = out.size();
+    PutValue(out, static_cast<uint32_t>(payload.size()));
+    PutValue(out, ComputeCrc32(payload));
+    PutValue(out, ComputeCrc32(string_view(out).substr(header_start)));
+}
+
+static bool IsZeroFilled(string_view data) {
+    return all_of(data.begin(), data.end(), [](char c) {
+        return c == 0;
+    });
+}
+
+static bool DecodePayload(string_view payload, WalRecord& record) {
+    uint8_t type = 0;
+    if (!GetValue(payload, record.lsn) || !GetValue(payload, type) || !GetValue(payload, record.document_id)) {
+        return false;
+    }
+    record.type = static_cast<WalRecordType>(type);
+    if (record.type == WalRecordType::REMOVE_DOCUMENT) {
+        return payload.empty();
+    }
+    if (record.type != WalRecordType::ADD_DOCUMENT) {
+        return false;
+    }
+    uint8_t status = 0;
+    uint32_t rating_count = 0;
+    if (!GetValue(payload, status) || !GetValue(payload, rating_count) || payload.size() < rating_count * sizeof(int)) {
+        return false;
+    }
+    record.status = static_cast<DocumentStatus>(status);
+    record.ratings.resize(rating_count);
+    for (int& rating : record.ratings) {
+        GetValue(payload, rating);
+    }
+    uint32_t text_size = 0;
+    if (!GetValue(payload, text_size) || payload.size() != text_size) {
+        return false;
+    }
+    record.text = payload;
+    return true;
+}
+
+// Перебирает целые записи журнала; возвращает длину корректной части файла. Недописанная при падении
+// запись в конце файла отбрасывается: она обрывается концом файла или после нее только нули. Поврежденная
+// запись, за которой есть данные, - ошибка: отрезать ее вместе с последующими записями значило бы молча их потерять.
+// Размер данных проверяется CRC заголовка, поэтому запись, обрезанная концом файла, отличается от испорченного размера
+template <typename Callback>
+static size_t ForEachWalRecord(string_view data, Callback callback) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        string_view rest = data.substr(offset);
+        if (rest.size() < WAL_HEADER_SIZE) {
+            return offset;
+        }
+        const string_view header = rest.substr(0, WAL_HEADER_SIZE - sizeof(uint32_t));
+        uint32_t payload_size = 0;
+        uint32_t checksum = 0;
+        uint32_t header_checksum = 0;
+        GetValue(rest, payload_size);
+        GetValue(rest, checksum);
+        GetValue(rest, header_checksum);
+        if (ComputeCrc32(header) != header_checksum) {
+            if (IsZeroFilled(data.substr(offset))) {
+                return offset;
+            }
+            throw runtime_error("Write-ahead log is corrupted at offset "s + to_string(offset));
+        }
+        if (rest.size() < payload_size) {
+            return offset;
+        }
+        const string_view payload = rest.substr(0, payload_size);
+        const size_t record_end = offset + WAL_HEADER_SIZE + payload_size;
+        WalRecord record;
+        if (ComputeCrc32(payload) != checksum || !DecodePayload(payload, record)) {
+            if (IsZeroFilled(data.substr(record_end))) {
+                return offset;
+            }
+            throw runtime_error("Write-ahead log is corrupted at offset "s + to_string(offset));
+        }
+        callback(record);
+        offset = record_end;
+    }
+    return offset;
+}
+
+static string ReadFile(const string& path) {
+    ifstream input(path, ios::binary);
+    return string(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+}
+
+//Открытие журнала: недописанный хвост от прошлого падения отрезается, нумерация продолжается
+WriteAheadLog::WriteAheadLog(const string& path, WalSyncMode sync_mode)
+    : sync_mode_(sync_mode) {
+    const string existing = ReadFile(path);
+    const size_t valid_size = ForEachWalRecord(existing, [this](const WalRecord& record) {
+        last_lsn_ = record.lsn;
+    });
+    durable_lsn_ = last_lsn_;
+    durable_size_ = valid_size;
+
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd_ < 0) {
+        throw system_error(errno, generic_category(), "Cannot open write-ahead log "s + path);
+    }
+    if (ftruncate(fd_, static_cast<off_t>(valid_size)) != 0 || lseek(fd_, 0, SEEK_END) < 0) {
+        const int error = errno;
+        close(fd_);
+        throw system_error(error, generic_category(), "Cannot prepare write-ahead log "s + path);
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    try {
+        WaitDurable(GetLastLsn());
+    } catch (...) {
+    }
+    close(fd_);
+}
+
+uint64_t WriteAheadLog::AppendAddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    string payload;
+    payload.reserve(32 + ratings.size() * sizeof(int) + document.size());
+    PutValue(payload, uint64_t{0});
+    PutValue(payload, static_cast<uint8_t>(WalRecordType::ADD_DOCUMENT));
+    PutValue(payload, document_id);
+    PutValue(payload, static_cast<uint8_t>(status));
+    PutValue(payload, static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        PutValue(payload, rating);
+    }
+    PutValue(payload, static_cast<uint32_t>(document.size()));
+    payload.append(document);
+
+    return AppendRecord(payload);
+}
+
+uint64_t WriteAheadLog::AppendRemoveDocument(int document_id) {
+    string payload;
+    PutValue(payload, uint64_t{0});
+    PutValue(payload, static_cast<uint8_t>(WalRecordType::REMOVE_DOCUMENT));
+    PutValue(payload, document_id);
+
+    return AppendRecord(payload);
+}
+
+//Номер записи присваивается под блокировкой, поэтому порядок в файле совпадает с порядком номеров
+uint64_t WriteAheadLog::AppendRecord(const string& payload) {
+    string record = payload;
+    unique_lock lock(mutex_);
+    if (is_failed_) {
+        throw runtime_error("Write-ahead log is unusable after a failed write"s);
+    }
+    const uint64_t lsn = ++last_lsn_;
+    memcpy(record.data(), &lsn, sizeof(lsn));
+    PutHeader(pending_, record);
+    pending_ += record;
+
+    if (sync_mode_ == WalSyncMode::PER_RECORD) {
+        flushed_.wait(lock, [this] {
+            return !is_flushing_;
+        });
+        // Не сохраненная запись отрезается, чтобы вызывающий мог откатить изменение, не расходясь с журналом
+        try {
+            WriteAll(pending_);
+            if (fdatasync(fd_) != 0) {
+                throw system_error(errno, generic_category(), "Cannot sync write-ahead log"s);
+            }
+        } catch (...) {
+            pending_.clear();
+            --last_lsn_;
+            TruncateToDurable();
+            throw;
+        }
+        durable_size_ += pending_.size();
+        pending_.clear();
+        ++sync_count_;
+        durable_lsn_ = lsn;
+    }
+    return lsn;
+}
+
+void WriteAheadLog::WaitDurable(uint64_t lsn) {
+    unique_lock lock(mutex_);
+    while (durable_lsn_ < lsn) {
+        if (is_failed_) {
+            throw runtime_error("Write-ahead log failed before record "s + to_string(lsn) + " was saved"s);
+        }
+        if (is_flushing_) {
+            flushed_.wait(lock);
+            continue;
+        }
+        is_flushing_ = true;
+        string batch;
+        batch.swap(pending_);
+        const uint64_t batch_lsn = last_lsn_;
+        lock.unlock();
+
+        exception_ptr error;
+        try {
+            WriteAll(batch);
+            if (sync_mode_ != WalSyncMode::NONE && fdatasync(fd_) != 0) {
+                throw system_error(errno, generic_category(), "Cannot sync write-ahead log"s);
+            }
+        } catch (...) {
+            error = current_exception();
+        }
+
+        lock.lock();
+        is_flushing_ = false;
+        if (error) {
+            // Записи пачки уже вынуты из pending_, поэтому повторить их нельзя: ожидающие их потоки
+            // не должны получить успех, а недописанная запись не должна остаться в середине файла
+            is_failed_ = true;
+            pending_.clear();
+            TruncateToDurable();
+        } else {
+            durable_lsn_ = batch_lsn;
+            durable_size_ += batch.size();
+            if (sync_mode_ != WalSyncMode::NONE) {
+                ++sync_count_;
+            }
+        }
+        flushed_.notify_all();
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+}
+
+bool WriteAheadLog::IsFailed() const {
+    lock_guard guard(mutex_);
+    return is_failed_;
+}
+
+uint64_t WriteAheadLog::GetLastLsn() const {
+    lock_guard guard(mutex_);
+    return last_lsn_;
+}
+
+uint64_t WriteAheadLog::GetSyncCount() const {
+    lock_guard guard(mutex_);
+    return sync_count_;
+}
+
+void WriteAheadLog::WriteAll(const string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t result = write(fd_, data.data() + written, data.size() - written);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw system_error(errno, generic_category(), "Cannot write write-ahead log"s);
+        }
+        written += static_cast<size_t>(result);
+    }
+}
+
+//Вызывается под mutex_. Если отрезать несохраненные данные не удалось, журнал больше не принимает записей
+void WriteAheadLog::TruncateToDurable() {
+    const off_t durable_size = static_cast<off_t>(durable_size_);
+    if (ftruncate(fd_, durable_size) != 0 || lseek(fd_, durable_size, SEEK_SET) != durable_size) {
+        is_failed_ = true;
+    }
+}
+
+//Восстановление: повтор записей журнала поверх текущего состояния сервера
+WalReplayResult ReplayWriteAheadLog(const string& path, SearchServer& search_server, uint64_t after_lsn) {
+    const string data = ReadFile(path);
+    WalReplayResult result;
+    const size_t valid_size = ForEachWalRecord(data, [&search_server, &result, after_lsn](const WalRecord& record) {
+        result.last_lsn = record.lsn;
+        if (record.lsn <= after_lsn) {
+            return;
+        }
+        if (record.type == WalRecordType::ADD_DOCUMENT) {
+            search_server.AddDocument(record.document_id, record.text, record.status, record.ratings);
+        } else {
+            search_server.RemoveDocument(record.document_id);
+        }
+        ++result.applied_records;
+    });
+    result.is_tail_damaged = valid_size != data.size();
+    return result;
+}
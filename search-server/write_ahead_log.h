@@ -0,0 +1,73 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "document.h"
+
+class SearchServer;
+
+enum class WalSyncMode {
+    // Записи пишутся в файл пачками, но без fsync: переживают падение процесса, но не ОС
+    NONE,
+    PER_RECORD,
+    GROUP_COMMIT,
+};
+
+// Журнал изменений индекса. Запись: u32 размер данных, u32 CRC32 данных, u32 CRC32 двух предыдущих полей,
+// данные (u64 lsn, u8 тип, i32 id документа, для добавления - u8 статус, u32 число оценок, оценки,
+// u32 длина текста, текст). Числа записываются в порядке байт платформы.
+class WriteAheadLog {
+public:
+    // Недописанная запись в конце файла отрезается; поврежденная запись, за которой есть данные, - std::runtime_error
+    explicit WriteAheadLog(const std::string& path, WalSyncMode sync_mode = WalSyncMode::GROUP_COMMIT);
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    uint64_t AppendAddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    uint64_t AppendRemoveDocument(int document_id);
+
+    // Возвращает управление, когда запись lsn и все предыдущие сохранены. Первый ожидающий поток
+    // записывает и синхронизирует накопленную пачку за всех, остальные ждут ее завершения.
+    // Если пачку сохранить не удалось, ее записи теряются, файл обрезается до последней сохраненной записи,
+    // а журнал переходит в состояние ошибки: WaitDurable для несохраненных записей и Append* бросают исключение.
+    void WaitDurable(uint64_t lsn);
+
+    uint64_t GetLastLsn() const;
+    uint64_t GetSyncCount() const;
+    bool IsFailed() const;
+
+private:
+    uint64_t AppendRecord(const std::string& payload);
+    void WriteAll(const std::string& data);
+    void TruncateToDurable();
+
+    const WalSyncMode sync_mode_;
+    int fd_ = -1;
+    mutable std::mutex mutex_;
+    std::condition_variable flushed_;
+    std::string pending_;
+    uint64_t last_lsn_ = 0;
+    uint64_t durable_lsn_ = 0;
+    // Длина сохраненной части файла
+    uint64_t durable_size_ = 0;
+    uint64_t sync_count_ = 0;
+    bool is_flushing_ = false;
+    bool is_failed_ = false;
+};
+
+struct WalReplayResult {
+    uint64_t applied_records = 0;
+    uint64_t last_lsn = 0;
+    // В конце журнала была недописанная или поврежденная запись
+    bool is_tail_damaged = false;
+};
+
+// Применяет к серверу записи с lsn > after_lsn. Сервер может быть пустым или загруженным из базового
+// образа, сделанного на момент after_lsn. Поврежденная запись не в конце журнала - std::runtime_error.
+WalReplayResult ReplayWriteAheadLog(const std::string& path, SearchServer& search_server, uint64_t after_lsn = 0);